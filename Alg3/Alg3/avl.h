@@ -1,3 +1,5 @@
+#pragma once
+
 #include "bst.h"
 
 #include <vector>
@@ -19,10 +21,14 @@ public:
     virtual bool add(Key key, Data obj, int* op = NULL);    //включение данных с заданным ключом
     virtual bool remove(Key key, int* op = NULL);           //удаление данных с заданным ключом
     bool check();                                           //проверка структуры узлов на корректность
+    int remove_range(Key lo, Key hi, int* op = NULL);       //удаление всех ключей из [lo, hi], возвращает их число
+    template<class P>
+    int remove_if(Key lo, Key hi, P pred, int* op = NULL);  //удаление ключей из [lo, hi], для которых pred(key, data)
+    int transfer(Key lo, Key hi, AVLTree<Data, Key>& target, int* op = NULL); //перенос ключей из [lo, hi] в target целым поддеревом
 
 
 private:
-    virtual void _show(Node* r, int level);                    //вспомогательная функция для вывода структуры
+    virtual void _show(Node* r, int level, ostream& out);      //вспомогательная функция для вывода структуры
 
     bool _check(Node* root);                                   //проверка на внутреннюю целостность дерева
     int _bfactor(Node* node);                                  //разность высот левого и правого поддерева
@@ -31,10 +37,24 @@ private:
     Node* LL(Node* a);                                         //большой левый поворот вокруг а
     Node* R(Node* a);                                          //малый правый поворот вокруг а
     Node* RR(Node* a);                                         //большой правый поворот вокруг а
-    void _fix_son(Node* parent, Node* old_son, Node* new_son); //поправить родителю old_son соответствующего сына на new_son
     void _fix_height(Node* node);                              //в предположении, что высоты всех поддеревьев node верны, выставить высоту node
 
-    Node* _just_add(Key key, Data obj, int* op = NULL);
+protected:
+    Node* _insert(Key key, Data obj, int* op = NULL);          //добавление с балансировкой, возвращает новый узел или NULL
+    virtual void _erase(Node* z, int* op = NULL);              //удаление узла z с балансировкой и освобождением
+
+private:
+
+    // операции над отсоединенными поддеревьями (корень без родителя, root дерева не трогается)
+    Node* _rotate_subtree_left(Node* a);                       //малый левый поворот, возвращает новый корень
+    Node* _rotate_subtree_right(Node* a);                      //малый правый поворот, возвращает новый корень
+    Node* _balance(Node* a);                                   //восстановить баланс a, если высоты сыновей различаются не более чем на 2
+    Node* _join(Node* l, Node* k, Node* r);                    //слияние l < k < r
+    Node* _join(Node* l, Node* r);                             //слияние l < r
+    Node* _split_last(Node* t, Node*& last);                   //отделить от t максимальный узел last
+    void _split(Node* t, Key key, bool take_equal, Node*& l, Node*& r, int* op = NULL); //разрезать t по ключу
+    Node* _build(vector<Node*>& nodes, int from, int to);      //сбалансированное поддерево из упорядоченных узлов [from, to)
+    void _collect(Node* t, vector<Node*>& nodes);              //узлы поддерева в порядке LtR
 };
 
 //конструктор без параметров
@@ -48,8 +68,8 @@ template<class Data, class Key>
 bool AVLTree<Data, Key>::check()
 {
     if (!this->root)
-        return true;
-    return _check(this->root);
+        return this->_check_ends();
+    return _check(this->root) && this->_check_stats(this->root) && this->_check_ends();
 }
 
 //деструктор
@@ -69,38 +89,39 @@ int AVLTree<Data, Key>::_bfactor(Node* node)
 
 //вспомогательная функция для вывода структуры
 template <class Data, class Key>
-void AVLTree<Data, Key>::_show(Node* r, int level)
+void AVLTree<Data, Key>::_show(Node* r, int level, ostream& out)
 {
     if (r == NULL)
         return;
-    _show(r->right, level + 1);
+    _show(r->right, level + 1, out);
     for (int i = 0; i <= 2 * level; i++)
-        cout << " ";
-    cout << r->key << "," <<_bfactor(r) << endl;
-    _show(r->left, level + 1);
+        out << " ";
+    out << r->key << "," <<_bfactor(r) << '\n';
+    _show(r->left, level + 1, out);
 }
 
 // проверка на корректность структуры дерева: ссылки на родителей и детей взаимно согласованы,
-// а высоты родителей согласованы с высотами детей.
+// ключи детей упорядочены относительно родителя, высоты родителей согласованы с высотами детей,
+// а высоты сыновей различаются не более чем на 1.
 template<class Data, class Key>
 bool AVLTree<Data, Key>::_check(Node* node)
 {
     int trueHeight = 1;
     if (node->left) {
-        if (node->left->parent != node)
+        if (node->left->parent != node || !(node->left->key < node->key))
             return false;
         if (!_check(node->left))
             return false;
         trueHeight = 1 + node->left->height;
     }
     if (node->right) {
-        if (node->right->parent != node)
+        if (node->right->parent != node || !(node->key < node->right->key))
             return false;
         if (!_check(node->right))
             return false;
         trueHeight = std::max(trueHeight, 1 + node->right->height);
     }
-    if (node->height != trueHeight)
+    if (node->height != trueHeight || _bfactor(node) < -1 || _bfactor(node) > 1)
         return false;
     return true;
 }
@@ -117,24 +138,6 @@ void AVLTree<Data, Key>::_fix_height(Node* node)
     node->height = std::max(lheight, rheight) + 1;
 };
 
-// проставить родителю old_son нового сына вместо него
-template<class Data, class Key>
-void AVLTree<Data, Key>::_fix_son(TNode<Data, Key>* parent, TNode<Data, Key>* old_son, TNode<Data, Key>* new_son)
-{
-    if (!parent) {
-        this->root = new_son;
-        return;
-    }
-
-    if (parent->left == old_son)
-        parent->left = new_son;
-    else if (parent->right == old_son)
-        parent->right = new_son;
-    else {
-        throw runtime_error("Оказалось, что родитель не родитель."); // this should not happen
-    }
-};
-
 // малый правый поворот вокруг a
 // (с корректировкой высот в поддереве)
 template<class Data, class Key>
@@ -149,9 +152,12 @@ TNode<Data, Key>* AVLTree<Data, Key>::R(TNode<Data, Key>* a)
     b->right = a;
     if (c)
         c->parent = a;
-    _fix_son(b->parent, a, b);
+    this->_fix_son(b->parent, a, b);
     _fix_height(a);
     _fix_height(b);
+    this->_pull(a);
+    this->_pull(b);
+    this->rotations++;
 
     return b;
 };
@@ -169,9 +175,12 @@ TNode<Data, Key>* AVLTree<Data, Key>::L(TNode<Data, Key>* a)
     b->left = a;
     if (c)
         c->parent = a;
-    _fix_son(b->parent, a, b);
+    this->_fix_son(b->parent, a, b);
     _fix_height(a);
     _fix_height(b);
+    this->_pull(a);
+    this->_pull(b);
+    this->rotations++;
 
     return b;
 };
@@ -198,10 +207,14 @@ TNode<Data, Key>* AVLTree<Data, Key>::LL(TNode<Data, Key>* a)
         m->parent = a;
     if (n)
         n->parent = b;
-    _fix_son(c->parent, a, c);
+    this->_fix_son(c->parent, a, c);
     _fix_height(a);
     _fix_height(b);
     _fix_height(c);
+    this->_pull(a);
+    this->_pull(b);
+    this->_pull(c);
+    this->rotations += 2;
 
     return c;
 }
@@ -228,70 +241,34 @@ TNode<Data, Key>* AVLTree<Data, Key>::RR(TNode<Data, Key>* a)
         m->parent = a;
     if (n)
         n->parent = b;
-    _fix_son(c->parent, a, c);
+    this->_fix_son(c->parent, a, c);
     _fix_height(a);
     _fix_height(b);
     _fix_height(c);
+    this->_pull(a);
+    this->_pull(b);
+    this->_pull(c);
+    this->rotations += 2;
 
     return c;
 }
 
-// Добавить новый узел в подходящее место дерева поиска и возвратить соответствующий Node.
+// добавление элемента в дерево
 template<class Data, class Key>
-TNode<Data, Key>* AVLTree<Data, Key>::_just_add(Key key, Data obj, int* op)
+bool AVLTree<Data, Key>::add(Key key, Data data, int* op)
 {
-    if (!this->root) {
-        this->root = new Node(obj, key);
-        ++(this->length);
-        return this->root;
-    }
-
-    Node* node = this->root;
-    while (1) {
-
-        if (op)
-            ++*op;
-
-        if (key < node->key) {
-            if (!node->left) {
-                Node* target = new Node(obj, key);
-                target->parent = node;
-                node->left = target;
-                ++(this->length);
-                return target;
-            }
-            node = node->left;
-            continue;
-        }
-
-        if (key > node->key) {
-            if (!node->right) {
-                Node* target = new Node(obj, key);
-                target->parent = node;
-                node->right = target;
-                ++(this->length);
-                return target;
-            }
-            node = node->right;
-            continue;
-        }
-
-        // key == node->key
-        return NULL;
-    }
-
-    throw runtime_error("Что-то пошло не так. Эта ошибка не должна произойти.");
+    if (op)
+        *op = 0;
+    return _insert(key, data, op) != NULL;
 }
 
 // добавление элемента в дерево с последующей нерекурсивной балансировкой от места добавления вверх
 template<class Data, class Key>
-bool AVLTree<Data, Key>::add(Key key, Data data, int* op)
+TNode<Data, Key>* AVLTree<Data, Key>::_insert(Key key, Data data, int* op)
 {
-    if (op)
-        *op = 0;
-    TNode<Data, Key>* new_node = _just_add(key, data, op);
+    TNode<Data, Key>* new_node = this->_just_add(key, data, op);
     if (!new_node) // не добавлен
-        return false;
+        return NULL;
 
     // Инвариант цикла. Перед исполнением цикла вершина a -- неизмененная вершина поддерева, в котором появился новый элемент.
     // Поддеревья уже AVL с верно проставленной высотой.
@@ -332,22 +309,35 @@ bool AVLTree<Data, Key>::add(Key key, Data data, int* op)
         a = a->parent;
     }
 
-    return true;
+    this->_pull_up(new_node);
+    return new_node;
 }
 
-// Перебалансируем так же, как и при добавлении: идем вверх от родителя удаленной вершины,
-// пока не встретим поддерево, в котором после перебалансировки не изменилась высота.
+// удаление элемента из дерева
 template<class Data, class Key>
 bool AVLTree<Data, Key>::remove(Key key, int* op)
 {
     if (op)
         *op = 0;
 
-    TNode<Data, Key>* a;
-    bool removed = this->_remove(key, this->root, a, op);
-    if (!removed) // не удален
+    TNode<Data, Key>* z = this->_find(key, op);
+    if (!z) // не удален
         return false;
 
+    _erase(z, op);
+    return true;
+}
+
+// Перебалансируем так же, как и при добавлении: идем вверх от родителя исключенной позиции,
+// пока не встретим поддерево, в котором после перебалансировки не изменилась высота.
+template<class Data, class Key>
+void AVLTree<Data, Key>::_erase(TNode<Data, Key>* z, int* op)
+{
+    TNode<Data, Key>* x;
+    TNode<Data, Key>* a;
+    this->_destroy(this->_unlink(z, x, a));
+
+    TNode<Data, Key>* parent = a;
     while (a) {
         if (op)
             ++*op;
@@ -356,18 +346,15 @@ bool AVLTree<Data, Key>::remove(Key key, int* op)
 
         _fix_height(a);
 
+        // в отличие от вставки, тяжелый сын может оказаться сбалансированным; тогда достаточно малого поворота
         if (_bfactor(a) == 2) {
-            int l_height = (!a->right) ? 0 : a->right->height;
-            int c_height = (!a->left->right) ? 0 : a->left->right->height;
-            if (c_height <= l_height) {
+            if (_bfactor(a->left) >= 0) {
                 a = R(a);
             } else {
                 a = RR(a);
             }
         } else if (_bfactor(a) == -2) {
-            int l_height = (!a->left) ? 0 : a->left->height;
-            int c_height = (!a->right->left) ? 0 : a->right->left->height;
-            if (c_height <= l_height) {
+            if (_bfactor(a->right) <= 0) {
                 a = L(a);
             } else {
                 a = LL(a);
@@ -379,5 +366,308 @@ bool AVLTree<Data, Key>::remove(Key key, int* op)
         a = a->parent;
     }
 
-    return true;
+    this->_pull_up(parent);
+}
+
+// Удаление диапазона за O(log n + k): дерево разрезается по lo и hi на три части,
+// средняя освобождается целиком, крайние сливаются. Балансировка выполняется только
+// на путях разреза и слияния.
+template<class Data, class Key>
+int AVLTree<Data, Key>::remove_range(Key lo, Key hi, int* op)
+{
+    if (op)
+        *op = 0;
+    if (hi < lo)
+        return 0;
+
+    Node *l, *m, *r, *rest;
+    _split(this->root, lo, false, l, rest, op);
+    _split(rest, hi, true, m, r, op);
+
+    int removed = (m) ? m->count : 0;
+    this->_filter_erase(m);
+    this->_clear(m);
+    this->length -= removed;
+    this->root = _join(l, r);
+    this->_fix_ends();
+    return removed;
+}
+
+// Удаление по условию: условие вычисляется до разреза, поэтому исключение из pred оставляет дерево целым.
+// Затем средняя часть разреза фильтруется, из оставшихся узлов строится идеально сбалансированное
+// поддерево, которое сливается с крайними частями.
+template<class Data, class Key>
+template<class P>
+int AVLTree<Data, Key>::remove_if(Key lo, Key hi, P pred, int* op)
+{
+    if (op)
+        *op = 0;
+    if (hi < lo)
+        return 0;
+
+    vector<bool> doomed;
+    int removed = 0;
+    for (Node* it = this->_lower_bound(lo); it != NULL && !(hi < it->key); it = this->_next(it)) {
+        if (op)
+            ++*op;
+        doomed.push_back(pred(it->key, it->data));
+        if (doomed.back())
+            removed++;
+    }
+    if (removed == 0)
+        return 0;
+
+    Node *l, *m, *r, *rest;
+    _split(this->root, lo, false, l, rest, op);
+    _split(rest, hi, true, m, r, op);
+
+    vector<Node*> nodes;
+    _collect(m, nodes);
+    int kept = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (doomed[i]) {
+            if (this->filter)
+                this->filter->erase(nodes[i]->key);
+            this->_destroy(nodes[i]);
+        }
+        else
+            nodes[kept++] = nodes[i];
+    }
+
+    this->length -= removed;
+    this->root = _join(_join(l, _build(nodes, 0, kept)), r);
+    this->_fix_ends();
+    return removed;
+}
+
+// Перенос диапазона за O(log n + log m): диапазон вырезается, как в remove_range, и сливается
+// с target одним поддеревом, без освобождения и выделения узлов. Все ключи диапазона должны быть
+// меньше или больше всех ключей target, а узлы обоих деревьев - простыми (см. _movable).
+template<class Data, class Key>
+int AVLTree<Data, Key>::transfer(Key lo, Key hi, AVLTree<Data, Key>& target, int* op)
+{
+    if (op)
+        *op = 0;
+    if (hi < lo || this == &target)
+        return 0;
+    if (!this->_movable() || !target._movable())
+        throw runtime_error("Узлы этого дерева нельзя переносить");
+    bool before = (target.root == NULL || hi < target.first->key);
+    if (!before && !(target.last->key < lo))
+        throw runtime_error("Диапазон перекрывается с ключами дерева-приемника");
+
+    Node *l, *m, *r, *rest;
+    _split(this->root, lo, false, l, rest, op);
+    _split(rest, hi, true, m, r, op);
+    this->root = _join(l, r);
+    this->_fix_ends();
+    if (!m)
+        return 0;
+
+    int moved = m->count;
+    Node* it = this->_min(m);
+    this->_filter_erase(m);
+    this->length -= moved;
+    target.root = (before) ? target._join(m, target.root) : target._join(target.root, m);
+    target.length += moved;
+    target._fix_ends();
+    if (target.filter) {
+        // пересборка фильтра учитывает все ключи target, перенесенные в том числе, поэтому ключи
+        // добавляются поштучно только без нее, иначе счетчики фильтра учли бы их дважды
+        if (target.length > 2 * target.filter->capacity())
+            target._filter_attach(target.filter->resized(2 * target.length));
+        else
+            for (int i = 0; i < moved; i++, it = target._next(it))
+                target.filter->insert(it->key);
+    }
+    return moved;
+}
+
+// малый левый поворот отсоединенного поддерева
+template<class Data, class Key>
+TNode<Data, Key>* AVLTree<Data, Key>::_rotate_subtree_left(Node* a)
+{
+    Node* b = a->right;
+    Node* c = b->left;
+
+    a->right = c;
+    if (c)
+        c->parent = a;
+    b->left = a;
+    a->parent = b;
+    b->parent = NULL;
+    _fix_height(a);
+    _fix_height(b);
+    this->_pull(a);
+    this->_pull(b);
+    this->rotations++;
+
+    return b;
+}
+
+// малый правый поворот отсоединенного поддерева
+template<class Data, class Key>
+TNode<Data, Key>* AVLTree<Data, Key>::_rotate_subtree_right(Node* a)
+{
+    Node* b = a->left;
+    Node* c = b->right;
+
+    a->left = c;
+    if (c)
+        c->parent = a;
+    b->right = a;
+    a->parent = b;
+    b->parent = NULL;
+    _fix_height(a);
+    _fix_height(b);
+    this->_pull(a);
+    this->_pull(b);
+    this->rotations++;
+
+    return b;
+}
+
+// восстановить баланс a одним или двумя поворотами, возвращает новый корень
+template<class Data, class Key>
+TNode<Data, Key>* AVLTree<Data, Key>::_balance(Node* a)
+{
+    _fix_height(a);
+    this->_pull(a);
+    if (_bfactor(a) == 2) {
+        if (_bfactor(a->left) < 0) {
+            a->left = _rotate_subtree_left(a->left);
+            a->left->parent = a;
+        }
+        return _rotate_subtree_right(a);
+    }
+    if (_bfactor(a) == -2) {
+        if (_bfactor(a->right) > 0) {
+            a->right = _rotate_subtree_right(a->right);
+            a->right->parent = a;
+        }
+        return _rotate_subtree_left(a);
+    }
+    return a;
+}
+
+// Слияние l < k < r: спускаемся по краю более высокого дерева до поддерева,
+// сравнимого по высоте с другим, подвешиваем туда k и балансируем на обратном пути.
+template<class Data, class Key>
+TNode<Data, Key>* AVLTree<Data, Key>::_join(Node* l, Node* k, Node* r)
+{
+    int lheight = (l) ? l->height : 0;
+    int rheight = (r) ? r->height : 0;
+
+    if (lheight > rheight + 1) {
+        Node* t = _join(l->right, k, r);
+        l->right = t;
+        t->parent = l;
+        return _balance(l);
+    }
+    if (rheight > lheight + 1) {
+        Node* t = _join(l, k, r->left);
+        r->left = t;
+        t->parent = r;
+        return _balance(r);
+    }
+
+    k->parent = NULL;
+    k->left = l;
+    k->right = r;
+    if (l)
+        l->parent = k;
+    if (r)
+        r->parent = k;
+    _fix_height(k);
+    this->_pull(k);
+    return k;
+}
+
+// слияние l < r через максимальный узел l
+template<class Data, class Key>
+TNode<Data, Key>* AVLTree<Data, Key>::_join(Node* l, Node* r)
+{
+    if (!l)
+        return r;
+    if (!r)
+        return l;
+    Node* last;
+    Node* rest = _split_last(l, last);
+    return _join(rest, last, r);
+}
+
+// отделить от t максимальный узел
+template<class Data, class Key>
+TNode<Data, Key>* AVLTree<Data, Key>::_split_last(Node* t, Node*& last)
+{
+    Node* tl = t->left;
+    Node* tr = t->right;
+    if (tl)
+        tl->parent = NULL;
+    if (!tr) {
+        last = t;
+        return tl;
+    }
+    tr->parent = NULL;
+    return _join(tl, t, _split_last(tr, last));
+}
+
+// разрезать t на l (ключи меньше key, или не больше при take_equal) и r (остальные)
+template<class Data, class Key>
+void AVLTree<Data, Key>::_split(Node* t, Key key, bool take_equal, Node*& l, Node*& r, int* op)
+{
+    if (!t) {
+        l = r = NULL;
+        return;
+    }
+    if (op)
+        ++*op;
+
+    Node* tl = t->left;
+    Node* tr = t->right;
+    if (tl)
+        tl->parent = NULL;
+    if (tr)
+        tr->parent = NULL;
+
+    if (t->key < key || (take_equal && !(key < t->key))) {
+        Node* middle;
+        _split(tr, key, take_equal, middle, r, op);
+        l = _join(tl, t, middle);
+    } else {
+        Node* middle;
+        _split(tl, key, take_equal, l, middle, op);
+        r = _join(middle, t, tr);
+    }
+}
+
+// сбалансированное поддерево из упорядоченных узлов [from, to)
+template<class Data, class Key>
+TNode<Data, Key>* AVLTree<Data, Key>::_build(vector<Node*>& nodes, int from, int to)
+{
+    if (from >= to)
+        return NULL;
+    int mid = (from + to) / 2;
+    Node* node = nodes[mid];
+    node->parent = NULL;
+    node->left = _build(nodes, from, mid);
+    node->right = _build(nodes, mid + 1, to);
+    if (node->left)
+        node->left->parent = node;
+    if (node->right)
+        node->right->parent = node;
+    _fix_height(node);
+    this->_pull(node);
+    return node;
+}
+
+// узлы поддерева в порядке LtR
+template<class Data, class Key>
+void AVLTree<Data, Key>::_collect(Node* t, vector<Node*>& nodes)
+{
+    if (!t)
+        return;
+    _collect(t->left, nodes);
+    nodes.push_back(t);
+    _collect(t->right, nodes);
 }
@@ -0,0 +1,67 @@
+// Кэш на Zipf-трассе: доля попаданий и пропускная способность LRU и LFU при разной емкости.
+// Обращение - find, при промахе запись добавляется (с вытеснением, если кэш полон).
+// Сборка: g++ -O2 -std=c++14 bench_cache.cpp -o bench_cache
+// Запуск: bench_cache [длина трассы, по умолчанию 2000000] [число ключей, 100000] [показатель Zipf, 0.99]
+
+#include "cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+using namespace std;
+
+// Трасса из length обращений к keys ключам с вероятностью ключа ранга i, пропорциональной 1 / i^s.
+// Ранги перемешиваются умножением, чтобы популярные ключи не были соседними в дереве.
+static vector<int> zipf_trace(int length, int keys, double s)
+{
+    vector<double> cdf(keys);
+    double total = 0;
+    for (int i = 0; i < keys; i++) {
+        total += 1.0 / pow(i + 1, s);
+        cdf[i] = total;
+    }
+    vector<int> trace(length);
+    srand(11);
+    for (int i = 0; i < length; i++) {
+        double u = (rand() / (double)RAND_MAX) * total;
+        int rank = (int)(lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+        trace[i] = (int)((rank * 2654435761u) % keys);
+    }
+    return trace;
+}
+
+//прогон трассы через кэш
+static void run(const vector<int>& trace, long long capacity, CacheTree<int, int>::Policy policy)
+{
+    CacheTree<int, int> cache(capacity, policy);
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < trace.size(); i++)
+        if (cache.find(trace[i]) == NULL)
+            cache.add(trace[i], (int)i);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    printf("%-4s %9lld %9.3f %12.2f %10d%s\n", (policy == CacheTree<int, int>::LRU) ? "LRU" : "LFU",
+           capacity, (double)cache.hit_count() / trace.size(), trace.size() / ms / 1000,
+           cache.eviction_count(), cache.check() ? "" : " (check failed)");
+}
+
+int main(int argc, char* argv[])
+{
+    int length = (argc > 1) ? atoi(argv[1]) : 2000000;
+    int keys = (argc > 2) ? atoi(argv[2]) : 100000;
+    double s = (argc > 3) ? atof(argv[3]) : 0.99;
+
+    vector<int> trace = zipf_trace(length, keys, s);
+    printf("Zipf(%.2f) trace of %d accesses over %d keys\n", s, length, keys);
+    printf("%-4s %9s %9s %12s %10s\n", "", "capacity", "hit rate", "Mops/s", "evictions");
+    long long capacities[] = { keys / 100, keys / 20, keys / 5 }; //1%, 5% и 20% ключей
+    for (int i = 0; i < 3; i++) {
+        run(trace, capacities[i], CacheTree<int, int>::LRU);
+        run(trace, capacities[i], CacheTree<int, int>::LFU);
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Сравнение способов балансировки: AVL, красно-черное дерево, WAVL и декартово дерево.
+// Для каждого сценария выводятся время, число поворотов и высота дерева.
+// Сборка: g++ -O2 -std=c++14 bench_engines.cpp -o bench_engines
+// Запуск: bench_engines [число ключей, по умолчанию 1000000]
+
+#include "avl.h"
+#include "rbt.h"
+#include "wavl.h"
+#include "treap.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+using namespace std;
+
+//миллисекунды с момента start
+static double elapsed(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+//вывод одной строки таблицы
+static void report(const char* engine, const char* scenario, double ms, int n, int rotations, int height)
+{
+    printf("%-6s %-20s %9.1f ms %8.1f ns/op %10d rot %4d h\n",
+           engine, scenario, ms, ms * 1e6 / n, rotations, height);
+}
+
+// Сценарии: вставка возрастающих ключей, вставка случайных ключей, поиск всех ключей,
+// удаление половины ключей в случайном порядке.
+template<class T>
+static void run(const char* engine, const vector<int>& keys)
+{
+    int n = (int)keys.size();
+    {
+        T tree;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < n; i++)
+            tree.add(i, i);
+        report(engine, "sequential add", elapsed(start), n, tree.rotation_count(), tree.height());
+    }
+
+    T tree;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+        tree.add(keys[i], i);
+    report(engine, "random add", elapsed(start), n, tree.rotation_count(), tree.height());
+
+    long long sum = 0;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+        sum += *tree.find(keys[i]);
+    report(engine, "find", elapsed(start), n, 0, tree.height());
+
+    int before = tree.rotation_count();
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < n; i += 2)
+        tree.remove(keys[i]);
+    report(engine, "random remove (1/2)", elapsed(start), n / 2, tree.rotation_count() - before, tree.height());
+
+    if (!tree.check() || sum < 0)
+        printf("%s: check failed\n", engine);
+}
+
+int main(int argc, char* argv[])
+{
+    int n = (argc > 1) ? atoi(argv[1]) : 1000000;
+    vector<int> keys(n);
+    for (int i = 0; i < n; i++)
+        keys[i] = i;
+    srand(1);
+    for (int i = n - 1; i > 0; i--)
+        swap(keys[i], keys[(int)(((long long)rand() * RAND_MAX + rand()) % (i + 1))]);
+
+    run<AVLTree<int, int> >("AVL", keys);
+    run<RBTree<int, int> >("RB", keys);
+    run<WAVLTree<int, int> >("WAVL", keys);
+    run<Treap<int, int> >("Treap", keys);
+    return 0;
+}
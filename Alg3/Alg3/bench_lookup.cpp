@@ -0,0 +1,77 @@
+// Поиск с промахами: read() с перехватом исключения против find() и find() с фильтром Блума.
+// Дерево содержит четные ключи, промахи - нечетные ключи из того же диапазона.
+// Сборка: g++ -O2 -std=c++14 bench_lookup.cpp -o bench_lookup
+// Запуск: bench_lookup [число ключей, по умолчанию 1000000] [число запросов, по умолчанию 2000000]
+
+#include "avl.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+using namespace std;
+
+//запросы с долей промахов misses (в процентах)
+static vector<int> make_queries(int n, int count, int misses)
+{
+    vector<int> queries(count);
+    for (int i = 0; i < count; i++) {
+        int k = 2 * (int)(((long long)rand() * RAND_MAX + rand()) % n);
+        queries[i] = (rand() % 100 < misses) ? k + 1 : k;
+    }
+    return queries;
+}
+
+//миллисекунды прогона запросов, в sum - сумма найденных данных
+template<class F>
+static double measure(const vector<int>& queries, long long& sum, F lookup)
+{
+    sum = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < queries.size(); i++)
+        sum += lookup(queries[i]);
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    int n = (argc > 1) ? atoi(argv[1]) : 1000000;
+    int count = (argc > 2) ? atoi(argv[2]) : 2000000;
+
+    AVLTree<int, int> tree;
+    for (int i = 0; i < n; i++)
+        tree.add(2 * i, i);
+    AVLTree<int, int> filtered;
+    for (int i = 0; i < n; i++)
+        filtered.add(2 * i, i);
+    filtered.enable_filter(n);
+
+    srand(3);
+    printf("%d keys, %d lookups\n", n, count);
+    printf("%7s %14s %10s %12s\n", "misses", "read+catch ms", "find ms", "find+bloom ms");
+    int ratios[] = { 10, 40, 90 };
+    for (int r = 0; r < 3; r++) {
+        vector<int> queries = make_queries(n, count, ratios[r]);
+        long long thrown_sum, find_sum, bloom_sum;
+        double thrown = measure(queries, thrown_sum, [&tree](int key) {
+            try {
+                return tree.read(key);
+            } catch (runtime_error&) {
+                return 0;
+            }
+        });
+        double found = measure(queries, find_sum, [&tree](int key) {
+            int* data = tree.find(key);
+            return (data) ? *data : 0;
+        });
+        double bloom = measure(queries, bloom_sum, [&filtered](int key) {
+            int* data = filtered.find(key);
+            return (data) ? *data : 0;
+        });
+        printf("%6d%% %14.0f %10.0f %12.0f%s\n", ratios[r], thrown, found, bloom,
+               (thrown_sum == find_sum && find_sum == bloom_sum) ? "" : " (sums differ)");
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+// Очередь планировщика по сроку: извлечь задачу с наименьшим сроком и запланировать ее заново.
+// Сравниваются pop_min, remove по ключу первого элемента итератора, std::set пар (срок, задача)
+// и std::priority_queue. Сроки в деревьях уникальны, поэтому в std::set занятый срок тоже сдвигается;
+// очередь с приоритетом допускает равные сроки, и ее контрольная сумма может отличаться.
+// Сборка: g++ -O2 -std=c++14 bench_pq.cpp -o bench_pq
+// Запуск: bench_pq [число задач, по умолчанию 100000] [число операций, по умолчанию 2000000]
+
+#include "avl.h"
+#include "rbt.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <set>
+#include <climits>
+#include <utility>
+#include <vector>
+
+
+using namespace std;
+
+//новый срок задачи, извлеченной со сроком key на шаге i (ключи кратны 16, младшие биты различают совпадения)
+static int reschedule(int key, int n, int i)
+{
+    return key + n * 8 + (int)((i * 7919u) % 1024) * 16 + (i & 15);
+}
+
+//миллисекунды работы body, в sum - контрольная сумма
+template<class F>
+static double measure(long long& sum, F body)
+{
+    auto start = chrono::steady_clock::now();
+    sum = body();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+//извлечение через pop_min: узел с наименьшим ключом известен, спуска нет
+template<class T>
+static long long run_pop(int n, int ops)
+{
+    T tree;
+    for (int i = 0; i < n; i++)
+        tree.add(i * 16, i);
+    long long sum = 0;
+    int key = 0, task = 0;
+    for (int i = 0; i < ops; i++) {
+        tree.pop_min(&key, &task);
+        sum += task;
+        int next = reschedule(key, n, i);
+        while (!tree.add(next, task))
+            next++;
+    }
+    return sum;
+}
+
+//извлечение прежним способом: первый ключ итератора, затем remove с новым спуском
+template<class T>
+static long long run_remove(int n, int ops)
+{
+    T tree;
+    for (int i = 0; i < n; i++)
+        tree.add(i * 16, i);
+    long long sum = 0;
+    typename T::Iterator it(tree);
+    for (int i = 0; i < ops; i++) {
+        it.begin();
+        int key = it.key();
+        int task = *it;
+        tree.remove(key);
+        sum += task;
+        int next = reschedule(key, n, i);
+        while (!tree.add(next, task))
+            next++;
+    }
+    return sum;
+}
+
+int main(int argc, char* argv[])
+{
+    int n = (argc > 1) ? atoi(argv[1]) : 100000;
+    int ops = (argc > 2) ? atoi(argv[2]) : 2000000;
+    long long sum;
+
+    printf("%d tasks, %d pop+reschedule operations\n", n, ops);
+    double ms = measure(sum, [n, ops]() { return run_pop<AVLTree<int, int> >(n, ops); });
+    printf("AVLTree pop_min        %8.0f ms (%lld)\n", ms, sum);
+    ms = measure(sum, [n, ops]() { return run_remove<AVLTree<int, int> >(n, ops); });
+    printf("AVLTree remove(min)    %8.0f ms (%lld)\n", ms, sum);
+    ms = measure(sum, [n, ops]() { return run_pop<RBTree<int, int> >(n, ops); });
+    printf("RBTree pop_min         %8.0f ms (%lld)\n", ms, sum);
+
+    ms = measure(sum, [n, ops]() {
+        set<pair<int, int> > queue;
+        for (int i = 0; i < n; i++)
+            queue.insert(make_pair(i * 16, i));
+        long long total = 0;
+        for (int i = 0; i < ops; i++) {
+            pair<int, int> top = *queue.begin();
+            queue.erase(queue.begin());
+            total += top.second;
+            int next = reschedule(top.first, n, i);
+            set<pair<int, int> >::iterator busy = queue.lower_bound(make_pair(next, INT_MIN));
+            while (busy != queue.end() && busy->first == next) {
+                next++;
+                busy = queue.lower_bound(make_pair(next, INT_MIN));
+            }
+            queue.insert(busy, make_pair(next, top.second));
+        }
+        return total;
+    });
+    printf("std::set               %8.0f ms (%lld)\n", ms, sum);
+
+    ms = measure(sum, [n, ops]() {
+        priority_queue<pair<int, int>, vector<pair<int, int> >, greater<pair<int, int> > > queue;
+        for (int i = 0; i < n; i++)
+            queue.push(make_pair(i * 16, i));
+        long long total = 0;
+        for (int i = 0; i < ops; i++) {
+            pair<int, int> top = queue.top();
+            queue.pop();
+            total += top.second;
+            queue.push(make_pair(reschedule(top.first, n, i), top.second));
+        }
+        return total;
+    });
+    printf("std::priority_queue    %8.0f ms (%lld)\n", ms, sum);
+    return 0;
+}
@@ -0,0 +1,60 @@
+// Истечение срока жизни: удаление самых старых 10% ключей (ключ - момент записи).
+// Сравниваются цикл remove по одному ключу, remove_range и remove_if по вдвое более широкому интервалу.
+// Сборка: g++ -O2 -std=c++14 bench_range.cpp -o bench_range
+// Запуск: bench_range [число ключей, по умолчанию 1000000] [число повторов, по умолчанию 5]
+
+#include "avl.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+
+using namespace std;
+
+//дерево из n возрастающих ключей
+static void fill(AVLTree<int, int>& tree, int n)
+{
+    for (int i = 0; i < n; i++)
+        tree.add(i, i);
+}
+
+//удаление самых старых 10% одним из способов, возвращает миллисекунды
+template<class F>
+static double expire(int n, F remove_oldest)
+{
+    AVLTree<int, int> tree;
+    fill(tree, n);
+    auto start = chrono::steady_clock::now();
+    remove_oldest(tree, n / 10);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    if (!tree.check() || tree.size() != n - n / 10)
+        printf("check failed\n");
+    return ms;
+}
+
+int main(int argc, char* argv[])
+{
+    int n = (argc > 1) ? atoi(argv[1]) : 1000000;
+    int repeats = (argc > 2) ? atoi(argv[2]) : 5;
+
+    double loop = 0, range = 0, pred = 0;
+    for (int r = 0; r < repeats; r++) {
+        loop += expire(n, [](AVLTree<int, int>& tree, int k) {
+            for (int i = 0; i < k; i++)
+                tree.remove(i);
+        });
+        range += expire(n, [](AVLTree<int, int>& tree, int k) {
+            tree.remove_range(0, k - 1);
+        });
+        pred += expire(n, [](AVLTree<int, int>& tree, int k) {
+            tree.remove_if(0, 2 * k - 1, [k](int, int& stamp) { return stamp < k; });
+        });
+    }
+
+    printf("expire oldest %d of %d keys, average of %d runs\n", n / 10, n, repeats);
+    printf("remove loop   %9.2f ms\n", loop / repeats);
+    printf("remove_range  %9.2f ms\n", range / repeats);
+    printf("remove_if     %9.2f ms (predicate over the oldest 20%%)\n", pred / repeats);
+    return 0;
+}
@@ -0,0 +1,73 @@
+// Масштабирование вставки по потокам: сегментированное дерево против одного AVL-дерева под общим мьютексом.
+// Каждый поток вставляет свою долю случайных ключей; выводится время и пропускная способность.
+// Сборка: g++ -O2 -std=c++14 -pthread bench_sharded.cpp -o bench_sharded
+// Запуск: bench_sharded [число ключей, по умолчанию 2000000] [число сегментов, по умолчанию 64]
+
+#include "sharded.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+
+//одно дерево под общим мьютексом
+struct LockedTree {
+    AVLTree<int, int> tree;
+    mutex lock;
+
+    bool add(int key, int data) {
+        lock_guard<mutex> guard(lock);
+        return tree.add(key, data);
+    }
+};
+
+//случайный ключ потока (линейный конгруэнтный генератор, неотрицательный результат)
+static int next_key(unsigned int& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return (int)(state >> 1);
+}
+
+//вставка n ключей в threads потоков, возвращает миллисекунды
+template<class T>
+static double run(T& target, int n, int threads)
+{
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++)
+        workers.push_back(thread([&target, n, threads, t]() {
+            unsigned int state = 7919u * (t + 1);
+            for (int i = t; i < n; i += threads)
+                target.add(next_key(state), i);
+        }));
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    int n = (argc > 1) ? atoi(argv[1]) : 2000000;
+    int shards = (argc > 2) ? atoi(argv[2]) : 64;
+    vector<int> bounds;
+    for (int i = 1; i < shards; i++)
+        bounds.push_back((int)(2147483647LL * i / shards));
+
+    printf("hardware threads: %u\n", thread::hardware_concurrency());
+    printf("%7s %14s %14s %9s\n", "threads", "locked Mops/s", "sharded Mops/s", "speedup");
+    for (int threads = 1; threads <= 32; threads *= 2) {
+        LockedTree locked;
+        double locked_ms = run(locked, n, threads);
+        ShardedTree<int, int> sharded(bounds);
+        double sharded_ms = run(sharded, n, threads);
+        if (!sharded.check() || sharded.size() != locked.tree.size())
+            printf("check failed\n");
+        printf("%7d %14.2f %14.2f %9.2f\n", threads, n / locked_ms / 1000, n / sharded_ms / 1000, locked_ms / sharded_ms);
+    }
+    return 0;
+}
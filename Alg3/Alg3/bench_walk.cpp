@@ -0,0 +1,113 @@
+// Полный обход: прежний walk() со стеком в векторе длины n против for_each, Iterator и нового walk(ostream).
+// Обход без вывода суммирует ключи, обход с выводом пишет "key->" в строковый поток.
+// Сборка: g++ -O2 -std=c++14 bench_walk.cpp -o bench_walk
+// Запуск: bench_walk [число ключей, по умолчанию 1000000] [число повторов, по умолчанию 10]
+
+#include "avl.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+
+using namespace std;
+
+// Дерево с прежним обходом: стек up длины n выделяется при каждом вызове.
+// visit(node) вызывается для узлов в порядке LtR.
+class LegacyTree: public AVLTree<int, int> {
+public:
+    template<class F>
+    void legacy_walk(F visit) {
+        Node* it = root;
+        std::vector<Node*> up(length);
+        int top = 0;
+
+        while (it != NULL) {
+            while (it != NULL) {
+                if (it->right != NULL)
+                    up[top++] = it->right;
+
+                up[top++] = it;
+                it = it->left;
+            }
+
+            it = up[--top];
+
+            while (top != 0 && it->right == NULL) {
+                visit(it);
+                it = up[--top];
+            }
+
+            visit(it);
+
+            if (top == 0)
+                break;
+
+            it = up[--top];
+        }
+    }
+};
+
+//миллисекунды на один повтор
+template<class F>
+static double measure(int repeats, F body)
+{
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+        body();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / repeats;
+}
+
+int main(int argc, char* argv[])
+{
+    int n = (argc > 1) ? atoi(argv[1]) : 1000000;
+    int repeats = (argc > 2) ? atoi(argv[2]) : 10;
+
+    LegacyTree tree;
+    srand(1);
+    for (int i = 0; i < n; i++)
+        tree.add(rand(), i);
+    n = tree.size();
+
+    long long expected = 0, sum = 0;
+    tree.for_each([&expected](int key, int&) { expected += key; return true; });
+
+    printf("full scan of %d keys, average of %d runs\n", n, repeats);
+    double ms = measure(repeats, [&]() {
+        sum = 0;
+        tree.legacy_walk([&sum](TNode<int, int>* node) { sum += node->key; });
+    });
+    printf("legacy walk stack     %8.2f ms%s\n", ms, (sum == expected) ? "" : " (wrong sum)");
+
+    ms = measure(repeats, [&]() {
+        sum = 0;
+        tree.for_each([&sum](int key, int&) { sum += key; return true; });
+    });
+    printf("for_each              %8.2f ms%s\n", ms, (sum == expected) ? "" : " (wrong sum)");
+
+    ms = measure(repeats, [&]() {
+        sum = 0;
+        LegacyTree::Iterator it(tree);
+        for (it.begin(); !it.is_off(); it.next())
+            sum += it.key();
+    });
+    printf("Iterator              %8.2f ms%s\n", ms, (sum == expected) ? "" : " (wrong sum)");
+
+    size_t legacy_bytes = 0, bytes = 0;
+    ms = measure(repeats, [&]() {
+        ostringstream out;
+        tree.legacy_walk([&out](TNode<int, int>* node) { out << node->key << "->"; });
+        out << endl;
+        legacy_bytes = out.str().size();
+    });
+    printf("legacy walk to stream %8.2f ms\n", ms);
+
+    ms = measure(repeats, [&]() {
+        ostringstream out;
+        tree.walk(out);
+        bytes = out.str().size();
+    });
+    printf("walk(ostream)         %8.2f ms%s\n", ms, (bytes == legacy_bytes) ? "" : " (output differs)");
+    return 0;
+}
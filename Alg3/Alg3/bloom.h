@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+
+using namespace std;
+
+// Фильтр отсутствующих ключей в том виде, в каком его видит дерево. Дерево обращается к фильтру
+// только через этот интерфейс, поэтому конкретный фильтр (и нужный ему std::hash<Key>)
+// компилируется, лишь когда вызван enable_filter. may_contain == false означает, что ключа точно нет.
+template <class Key> class KeyFilter
+{
+public:
+    virtual ~KeyFilter() {}
+    virtual void insert(const Key& key) = 0;                    //учесть ключ
+    virtual void erase(const Key& key) = 0;                     //забыть ключ
+    virtual bool may_contain(const Key& key) const = 0;         //ключ, возможно, присутствует
+    virtual void clear() = 0;                                   //очистка фильтра
+    virtual int capacity() const = 0;                           //ожидаемое число ключей
+    virtual KeyFilter<Key>* resized(int expected) const = 0;    //пустой фильтр того же вида на expected ключей
+};
+
+// Считающий фильтр Блума: вместо битов - 8-битные счетчики, поэтому ключи можно не только
+// добавлять, но и удалять. Насыщенный счетчик (255) больше не уменьшается.
+template <class Key> class BloomFilter: public KeyFilter<Key>
+{
+public:
+    BloomFilter(int expected, int bits_per_key = 10);      //конструктор по ожидаемому числу ключей
+    void insert(const Key& key);                            //учесть ключ
+    void erase(const Key& key);                             //забыть ключ
+    bool may_contain(const Key& key) const;                 //ключ, возможно, присутствует
+    void clear();                                           //очистка фильтра
+    int capacity() const;                                   //ожидаемое число ключей
+    KeyFilter<Key>* resized(int expected) const;            //пустой фильтр с тем же числом счетчиков на ключ
+
+private:
+    vector<unsigned char> counters;                         //счетчики
+    int hashes;                                             //число хеш-функций
+    int expected;                                           //ожидаемое число ключей
+    int bits;                                               //число счетчиков на ключ
+
+    static unsigned long long _mix(unsigned long long x);   //перемешивание хеша (splitmix64)
+    size_t _slot(unsigned long long h1, unsigned long long h2, int i) const; //i-я позиция по двойному хешированию
+};
+
+//конструктор по ожидаемому числу ключей
+template<class Key>
+BloomFilter<Key>::BloomFilter(int expected, int bits_per_key)
+{
+    this->expected = std::max(expected, 1);
+    bits = std::max(bits_per_key, 1);
+    counters.assign((size_t)this->expected * bits, 0);
+    hashes = std::max(1, (int)(bits * 0.69 + 0.5)); // k = m/n * ln 2
+}
+
+//перемешивание хеша: стандартный хеш целых чисел может быть тождественным
+template<class Key>
+unsigned long long BloomFilter<Key>::_mix(unsigned long long x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+//i-я позиция по двойному хешированию
+template<class Key>
+size_t BloomFilter<Key>::_slot(unsigned long long h1, unsigned long long h2, int i) const
+{
+    return (size_t)((h1 + i * h2) % counters.size());
+}
+
+//учесть ключ
+template<class Key>
+void BloomFilter<Key>::insert(const Key& key)
+{
+    unsigned long long h1 = _mix(std::hash<Key>()(key));
+    unsigned long long h2 = _mix(h1) | 1;
+    for (int i = 0; i < hashes; i++) {
+        unsigned char& c = counters[_slot(h1, h2, i)];
+        if (c < 255)
+            c++;
+    }
+}
+
+//забыть ключ
+template<class Key>
+void BloomFilter<Key>::erase(const Key& key)
+{
+    unsigned long long h1 = _mix(std::hash<Key>()(key));
+    unsigned long long h2 = _mix(h1) | 1;
+    for (int i = 0; i < hashes; i++) {
+        unsigned char& c = counters[_slot(h1, h2, i)];
+        if (c > 0 && c < 255)
+            c--;
+    }
+}
+
+//ключ, возможно, присутствует
+template<class Key>
+bool BloomFilter<Key>::may_contain(const Key& key) const
+{
+    unsigned long long h1 = _mix(std::hash<Key>()(key));
+    unsigned long long h2 = _mix(h1) | 1;
+    for (int i = 0; i < hashes; i++)
+        if (counters[_slot(h1, h2, i)] == 0)
+            return false;
+    return true;
+}
+
+//очистка фильтра
+template<class Key>
+void BloomFilter<Key>::clear()
+{
+    std::fill(counters.begin(), counters.end(), 0);
+}
+
+//ожидаемое число ключей
+template<class Key>
+int BloomFilter<Key>::capacity() const
+{
+    return expected;
+}
+
+//пустой фильтр с тем же числом счетчиков на ключ
+template<class Key>
+KeyFilter<Key>* BloomFilter<Key>::resized(int expected) const
+{
+    return new BloomFilter<Key>(expected, bits);
+}
@@ -1,7 +1,12 @@
+#pragma once
+
+#include "bloom.h"
+
 #include <vector>
 #include <iostream>
 #include <algorithm>
 #include <exception>
+#include <cstdlib>
 
 
 using namespace std;
@@ -12,17 +17,59 @@ class TNode
 public:
     Key key;                                        //ключ объекта
     Data data;                                      //значение объекта в элементе
-    int height;                                     //высота поддерева с данным корнем
+    int height;                                     //высота поддерева с данным корнем (в КЧ-дереве - цвет, в WAVL - ранг, в декартовом дереве - приоритет)
+    int count;                                      //число узлов в поддереве (стоит здесь, чтобы не было выравнивания)
     TNode<Data, Key>* parent;                       //указатель на родителя
     TNode<Data, Key>* left;                         //указатель на левого сына
     TNode<Data, Key>* right;                        //указатель на правого сына
+    int leaves;                                     //число листьев в поддереве
+    int levels;                                     //число уровней поддерева (независимо от способа балансировки)
+    long long depth_sum;                            //сумма уровней узлов поддерева (корень поддерева - уровень 1)
+    long long ext_sum;                              //сумма уровней узлов поддерева, у которых менее двух сыновей
     TNode(Data d, Key k) {                          //конструктор с параметрами
         key = k;
         data = d;
         height = 1;
         parent = left = right = NULL;
+        count = leaves = levels = depth_sum = ext_sum = 1;
+    }
+
+};
+
+// Буфер вывода: форматированный вывод копится в массиве фиксированного размера
+// и передается в целевой поток крупными блоками, без промежуточных сбросов.
+class BufferedWriter: public streambuf
+{
+private:
+    ostream& target;            //целевой поток
+    char buffer[4096];          //буфер
+
+public:
+    BufferedWriter(ostream& out) : target(out) {
+        setp(buffer, buffer + sizeof(buffer));
     }
 
+    ~BufferedWriter() {
+        sync();
+    }
+
+protected:
+    //буфер заполнен: передать его содержимое и символ c
+    virtual int_type overflow(int_type c) {
+        sync();
+        if (c != traits_type::eof()) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    //передать накопленное в целевой поток
+    virtual int sync() {
+        target.write(pbase(), pptr() - pbase());
+        setp(buffer, buffer + sizeof(buffer));
+        return target ? 0 : -1;
+    }
 };
 
 template <class Data, class Key> class Tree
@@ -34,28 +81,55 @@ protected:
     int length;                 //длина дерева
     Node* root;                 //указатель на корень
     bool ins;
+    int rotations;              //число выполненных поворотов
+    KeyFilter<Key>* filter;     //фильтр отсутствующих ключей (NULL - не используется)
+    Node* first;                //узел с наименьшим ключом
+    Node* last;                 //узел с наибольшим ключом
+    static const int STACK_DEPTH = 64; //глубина стека обхода for_each на стеке вызова
 
 public:
     Tree();                                                      //конструктор без параметров
     Tree(const Tree<Data, Key>& anotherTree);                    //конструктор копирования
-    ~Tree(void);                                                 //деструктор
+    virtual ~Tree(void);                                         //деструктор (виртуальный: наследники освобождают свои узлы)
     int size();                                                  //опрос размера дерева
     void clear();                                                //очистка дерева
     bool empty();                                                //проверка дерева на пустоту
-    Data& read(Key key, int* op = NULL);                         //доступ к данным с заданным ключом
+    virtual Data& read(Key key, int* op = NULL);                 //доступ к данным с заданным ключом
+    virtual Data* find(Key key, int* op = NULL);                 //указатель на данные с заданным ключом или NULL
+    bool contains(Key key, int* op = NULL);                      //проверка наличия ключа (через find)
+    bool try_read(Key key, Data& obj, int* op = NULL);           //копия данных с заданным ключом через find, false - ключа нет
+    void enable_filter(int expected = 0, int bits_per_key = 10); //включить фильтр Блума для быстрых промахов
+    Data& min();                                                 //данные с наименьшим ключом за O(1)
+    Data& max();                                                 //данные с наибольшим ключом за O(1)
+    Key min_key();                                               //наименьший ключ за O(1)
+    Key max_key();                                               //наибольший ключ за O(1)
+    Key key_at(int index);                                       //ключ с порядковым номером index (с 0) за O(log n)
+    bool pop_min(Key* key = NULL, Data* obj = NULL);             //извлечение элемента с наименьшим ключом без поиска
+    bool pop_max(Key* key = NULL, Data* obj = NULL);             //извлечение элемента с наибольшим ключом без поиска
+    void disable_filter();                                       //выключить фильтр Блума
     virtual bool add(Key key, Data obj, int* op = NULL);         //включение данных с заданным ключом
     virtual bool remove(Key key, int* op = NULL);                //удаление данных с заданным ключом
-    void print();                                                //вывод структуры дерева на экран
-    void walk();                                                 //обход узлов дерева по схеме
-    int external_path_length();                                  //определение длины внешнего пути дерева  (рекурсивно)
+    void print(ostream& out = cout);                             //вывод структуры дерева в поток
+    void walk(ostream& out = cout);                              //вывод ключей в порядке LtR в поток
+    template<class F> bool for_each(F visit);                    //обход LtR с вызовом visit(key, data)
+    template<class F> bool for_each_reverse(F visit);            //обход RtL с вызовом visit(key, data)
+    template<class F> bool for_each_in_range(Key lo, Key hi, F visit); //обход LtR ключей из [lo, hi]
+    long long external_path_length();                            //определение длины внешнего пути дерева
+    int height();                                                //высота дерева
+    int leaf_count();                                            //число листьев
+    double average_depth();                                      //средний уровень узла (корень - уровень 1)
+    double estimate_depth(int samples);                          //оценка среднего уровня по случайным спускам
+    int rotation_count();                                        //число поворотов, выполненных балансировкой
 
 protected:
     bool _add(Key key, Data obj, Node*& node, int* op = NULL);
     bool _remove(Key key, Node*& node, Node*& parent, int* op = NULL);
-    void _copy(Node* r);                                         //вспомогательная функция для копирования дерева
+    Node* _copy(Node* r, Node* parent);                          //копия поддерева с сохранением структуры и поля height
     void _clear(Node* r);                                        //вспомогательная функция для очистки дерева
-    virtual void _show(Node* r, int level);                      //вспомогательная функция для вывода структуры
-    void _count_level(Node* r, int level, int& sum);             //вспомогательная функция для определения внешнего пути
+    virtual void _show(Node* r, int level, ostream& out);        //вспомогательная функция для вывода структуры
+    void _pull(Node* node);                                      //пересчитать статистику узла по статистике сыновей
+    void _pull_up(Node* node);                                   //пересчитать статистику от узла до корня
+    bool _check_stats(Node* r);                                  //проверка статистики поддерева полным пересчетом
     Node* _BST_predecessor(Node* x, int* op = NULL);             //поиск предыдущего по ключу узла
     Node* _BST_successor(Node* x, int* op = NULL);               //поиск следующего по ключу узла
     Node* _max(Node* t, int* op = NULL);                         //поиск максимального по ключу узла в поддереве
@@ -63,6 +137,25 @@ protected:
     Node* _parent_right(Node* t, Node* x, int* op = NULL);       //поиск ближайшего правого родителя для заданного узла дерева
     Node* _parent_left(Node* t, Node* x, int* op = NULL);        //поиск ближайшего левого родителя для заданного узла дерева
     Data& _read(Key key, Node*& node, int* op = NULL);           //доступ к данным с заданным ключом в данном поддереве
+    Node* _find(Key key, int* op = NULL);                        //поиск узла с заданным ключом (NULL, если нет)
+    Node* _lookup(Key key, int* op = NULL);                      //поиск узла с предварительной проверкой по фильтру
+    void _filter_attach(KeyFilter<Key>* empty);                  //заменить фильтр пустым и учесть в нем все ключи
+    void _filter_add(Key key);                                   //учесть в фильтре добавленный ключ
+    void _filter_erase(Node* r);                                 //забыть в фильтре ключи поддерева
+    Node* _lower_bound(Key key);                                 //первый узел с ключом не меньше заданного
+    Node* _next(Node* x);                                        //следующий по ключу узел по ссылкам на родителей
+    Node* _prev(Node* x);                                        //предыдущий по ключу узел по ссылкам на родителей
+    virtual Node* _create(Key key, Data obj);                    //выделение нового узла (наследник может выделять расширенный узел)
+    virtual void _destroy(Node* node);                           //освобождение узла, выделенного _create
+    virtual bool _movable();                                     //узлы можно переносить в другое дерево (без ссылок вне дерева)
+    Node* _just_add(Key key, Data obj, int* op = NULL);          //добавление листа без балансировки
+    Node* _unlink(Node* z, Node*& x, Node*& xparent);            //исключение узла z из дерева без балансировки
+    virtual void _erase(Node* z, int* op = NULL);                //удаление узла z и освобождение (балансировку задают наследники)
+    void _fix_ends();                                            //пересчитать крайние узлы спуском от корня
+    bool _check_ends();                                          //проверка крайних узлов спуском от корня
+    void _fix_son(Node* parent, Node* old_son, Node* new_son);   //поправить родителю old_son соответствующего сына на new_son
+    void _rotate_left(Node* a);                                  //левый поворот вокруг a без пересчета высот
+    void _rotate_right(Node* a);                                 //правый поворот вокруг a без пересчета высот
 
 public:
     class Iterator
@@ -79,28 +172,27 @@ public:
 
         //установка на первый
         void begin() {
-            cur = ptr->root;
-            if (cur != NULL)
-                while (cur->left != NULL)
-                    cur = cur->left;
+            cur = ptr->first;
         }
 
         //установка на последний
         void end() {
-            cur = ptr->root;
-            if (cur != NULL)
-                while (cur->right != NULL)
-                    cur = cur->right;
+            cur = ptr->last;
         }
 
         //установка на следующий
         void next() {
-            cur = ptr->_BST_successor(cur);
+            cur = ptr->_next(cur);
         }
 
         //установка на предыдущий
         void prev() {
-            cur = ptr->_BST_predecessor(cur);
+            cur = ptr->_prev(cur);
+        }
+
+        //установка на первый элемент с ключом не меньше заданного
+        void seek(Key key) {
+            cur = ptr->_lower_bound(key);
         }
 
         //проверка состояния итератора
@@ -115,6 +207,14 @@ public:
             else
                 throw runtime_error("Итератор за пределами дерева");
         }
+
+        //ключ текущего элемента
+        Key key() const {
+            if (cur != NULL)
+                return cur->key;
+            else
+                throw runtime_error("Итератор за пределами дерева");
+        }
     };
 
     friend class Iterator;
@@ -125,6 +225,9 @@ template<class Data, class Key>
 Tree<Data, Key>::Tree(void)
 {
     length = 0;
+    rotations = 0;
+    filter = NULL;
+    first = last = NULL;
     root = NULL; //в начале дерево пусто
 }
 
@@ -134,18 +237,28 @@ Tree<Data, Key>::Tree(const Tree<Data, Key>& anotherTree)
 {
     root = NULL;
     length = 0;
-    _copy(anotherTree.root);
+    rotations = 0;
+    filter = NULL;
+    first = last = NULL;
+    root = _copy(anotherTree.root, NULL);
+    length = anotherTree.length;
+    _fix_ends();
 }
 
-//копирование дерева
+// Копирование поддерева узел в узел. Поле height переносится как есть: в наследниках оно хранит
+// цвет, ранг или приоритет, и повторная вставка ключей через add базового класса их бы испортила.
 template<class Data, class Key>
-void Tree<Data, Key>::_copy(Node* r)
+typename Tree<Data, Key>::Node* Tree<Data, Key>::_copy(Node* r, Node* parent)
 {
     if (r == NULL)
-        return;
-    add(r->key, r->data);
-    _copy(r->left);
-    _copy(r->right);
+        return NULL;
+    Node* node = new Node(r->data, r->key);
+    node->height = r->height;
+    node->parent = parent;
+    node->left = _copy(r->left, node);
+    node->right = _copy(r->right, node);
+    _pull(node);
+    return node;
 }
 
 template<class Data, class Key>
@@ -153,7 +266,7 @@ bool Tree<Data, Key>::_add(Key key, Data obj, Node*& node, int* op)
 {
 	
     if (node == NULL) {
-        node = new Node(obj, key);
+        node = _create(key, obj);
         length++;
         return true;
     }
@@ -163,12 +276,14 @@ bool Tree<Data, Key>::_add(Key key, Data obj, Node*& node, int* op)
         bool result = _add(key, obj, node->left, op);
         node->left->parent = node;
         node->height = std::max(node->height, node->left->height + 1);
+        _pull(node);
         return result;
     }
     if (key > node->key) {
         bool result = _add(key, obj, node->right, op);
         node->right->parent = node;
         node->height = std::max(node->height, node->right->height + 1);
+        _pull(node);
         return result;
     }
     // key == node->key
@@ -193,11 +308,207 @@ Data& Tree<Data, Key>::_read(Key key, Node*& node, int* op)
     return _read(key, node->left, op);
 }
 
+// нерекурсивный поиск узла с заданным ключом
+template<class Data, class Key>
+typename Tree<Data, Key>::Node* Tree<Data, Key>::_find(Key key, int* op)
+{
+    Node* node = root;
+    while (node != NULL) {
+        if (op)
+            ++*op;
+        if (key == node->key)
+            return node;
+        node = (key < node->key) ? node->left : node->right;
+    }
+    return NULL;
+}
+
+//выделение нового узла
+template<class Data, class Key>
+typename Tree<Data, Key>::Node* Tree<Data, Key>::_create(Key key, Data obj)
+{
+    return new Node(obj, key);
+}
+
+// Освобождение узла. Деструктор Tree вызывает только эту версию, поэтому наследник,
+// переопределивший _create, очищает дерево в своем деструкторе.
+template<class Data, class Key>
+void Tree<Data, Key>::_destroy(Node* node)
+{
+    delete node;
+}
+
+//простые узлы можно переносить в другое дерево
+template<class Data, class Key>
+bool Tree<Data, Key>::_movable()
+{
+    return true;
+}
+
+// Добавить новый узел в подходящее место дерева поиска и возвратить соответствующий Node.
+template<class Data, class Key>
+typename Tree<Data, Key>::Node* Tree<Data, Key>::_just_add(Key key, Data obj, int* op)
+{
+    if (!root) {
+        root = _create(key, obj);
+        ++length;
+        first = last = root;
+        _filter_add(key);
+        return root;
+    }
+
+    Node* node = root;
+    while (1) {
+
+        if (op)
+            ++*op;
+
+        if (key < node->key) {
+            if (!node->left) {
+                Node* target = _create(key, obj);
+                target->parent = node;
+                node->left = target;
+                ++length;
+                if (node == first)
+                    first = target;
+                _filter_add(key);
+                return target;
+            }
+            node = node->left;
+            continue;
+        }
+
+        if (key > node->key) {
+            if (!node->right) {
+                Node* target = _create(key, obj);
+                target->parent = node;
+                node->right = target;
+                ++length;
+                if (node == last)
+                    last = target;
+                _filter_add(key);
+                return target;
+            }
+            node = node->right;
+            continue;
+        }
+
+        // key == node->key
+        return NULL;
+    }
+
+    throw runtime_error("Что-то пошло не так. Эта ошибка не должна произойти.");
+}
+
+// Исключить узел z из дерева без балансировки. Если у z два сына, на его место переставляется
+// следующий узел y (ключи и данные не копируются, так что указатели на остальные узлы остаются верными),
+// а поля height узлов y и z меняются местами: возвращенный z несет поле освобожденной позиции.
+// Возвращает z (его освобождает вызывающий), x - сын, занявший освобожденную позицию (может быть NULL),
+// xparent - новый родитель x. Статистику от xparent до корня пересчитывает вызывающий после балансировки.
+template<class Data, class Key>
+typename Tree<Data, Key>::Node* Tree<Data, Key>::_unlink(Node* z, Node*& x, Node*& xparent)
+{
+    if (z == first)
+        first = _next(z);
+    if (z == last)
+        last = _prev(z);
+
+    Node* y = z;
+    if (z->left != NULL && z->right != NULL) {
+        y = z->right;
+        while (y->left != NULL)
+            y = y->left;
+    }
+
+    x = (y->left != NULL) ? y->left : y->right;
+    xparent = y->parent;
+    if (x != NULL)
+        x->parent = xparent;
+    _fix_son(xparent, y, x);
+
+    if (y != z) {
+        if (xparent == z)
+            xparent = y;
+        y->parent = z->parent;
+        y->left = z->left;
+        y->right = z->right;
+        if (y->left != NULL)
+            y->left->parent = y;
+        if (y->right != NULL)
+            y->right->parent = y;
+        _fix_son(y->parent, z, y);
+        std::swap(y->height, z->height);
+    }
+
+    z->parent = z->left = z->right = NULL;
+    length--;
+    if (filter)
+        filter->erase(z->key);
+    return z;
+}
+
+// проставить родителю old_son нового сына вместо него
+template<class Data, class Key>
+void Tree<Data, Key>::_fix_son(Node* parent, Node* old_son, Node* new_son)
+{
+    if (!parent) {
+        root = new_son;
+        return;
+    }
+
+    if (parent->left == old_son)
+        parent->left = new_son;
+    else if (parent->right == old_son)
+        parent->right = new_son;
+    else {
+        throw runtime_error("Оказалось, что родитель не родитель."); // this should not happen
+    }
+}
+
+// левый поворот вокруг a: правый сын b становится корнем поддерева
+template<class Data, class Key>
+void Tree<Data, Key>::_rotate_left(Node* a)
+{
+    Node* b = a->right;
+    Node* c = b->left;
+
+    b->parent = a->parent;
+    a->parent = b;
+    a->right = c;
+    b->left = a;
+    if (c)
+        c->parent = a;
+    _fix_son(b->parent, a, b);
+    _pull(a);
+    _pull(b);
+    rotations++;
+}
+
+// правый поворот вокруг a: левый сын b становится корнем поддерева
+template<class Data, class Key>
+void Tree<Data, Key>::_rotate_right(Node* a)
+{
+    Node* b = a->left;
+    Node* c = b->right;
+
+    b->parent = a->parent;
+    a->parent = b;
+    a->left = c;
+    b->right = a;
+    if (c)
+        c->parent = a;
+    _fix_son(b->parent, a, b);
+    _pull(a);
+    _pull(b);
+    rotations++;
+}
+
 //деструктор
 template<class Data, class Key>
 Tree<Data, Key>::~Tree(void)
 {
     clear();
+    delete filter;
 }
 
 //опрос размера дерева
@@ -214,7 +525,11 @@ void Tree<Data, Key>::clear()
     _clear(root);
     ///looked = length;
     root = NULL;
+    first = last = NULL;
     length = 0;
+    rotations = 0;
+    if (filter)
+        filter->clear();
 }
 
 //очистка по обходу LtR дерева
@@ -225,7 +540,7 @@ void Tree<Data, Key>::_clear(Node* r)
         return;
     _clear(r->left);
     Node* rtree = r->right;
-    delete r;
+    _destroy(r);
     _clear(rtree);
 }
 
@@ -245,13 +560,213 @@ Data& Tree<Data, Key>::read(Key key, int* op)
     return _read(key, root, op);
 }
 
+//данные с наименьшим ключом
+template<class Data, class Key>
+Data& Tree<Data, Key>::min()
+{
+    if (first == NULL)
+        throw runtime_error("Нет данных");
+    return first->data;
+}
+
+//данные с наибольшим ключом
+template<class Data, class Key>
+Data& Tree<Data, Key>::max()
+{
+    if (last == NULL)
+        throw runtime_error("Нет данных");
+    return last->data;
+}
+
+//наименьший ключ
+template<class Data, class Key>
+Key Tree<Data, Key>::min_key()
+{
+    if (first == NULL)
+        throw runtime_error("Нет данных");
+    return first->key;
+}
+
+//наибольший ключ
+template<class Data, class Key>
+Key Tree<Data, Key>::max_key()
+{
+    if (last == NULL)
+        throw runtime_error("Нет данных");
+    return last->key;
+}
+
+//ключ с порядковым номером index: спуск по числу узлов в левых поддеревьях
+template<class Data, class Key>
+Key Tree<Data, Key>::key_at(int index)
+{
+    if (index < 0 || index >= length)
+        throw runtime_error("Номер вне дерева");
+    Node* node = root;
+    while (1) {
+        int left = (node->left) ? node->left->count : 0;
+        if (index == left)
+            return node->key;
+        if (index < left)
+            node = node->left;
+        else {
+            index -= left + 1;
+            node = node->right;
+        }
+    }
+}
+
+//извлечение элемента с наименьшим ключом: известный узел удаляется без спуска от корня
+template<class Data, class Key>
+bool Tree<Data, Key>::pop_min(Key* key, Data* obj)
+{
+    if (first == NULL)
+        return false;
+    if (key)
+        *key = first->key;
+    if (obj)
+        *obj = first->data;
+    _erase(first);
+    return true;
+}
+
+//извлечение элемента с наибольшим ключом
+template<class Data, class Key>
+bool Tree<Data, Key>::pop_max(Key* key, Data* obj)
+{
+    if (last == NULL)
+        return false;
+    if (key)
+        *key = last->key;
+    if (obj)
+        *obj = last->data;
+    _erase(last);
+    return true;
+}
+
+//удаление узла z без балансировки (спуска нет, поэтому операции не считаются)
+template<class Data, class Key>
+void Tree<Data, Key>::_erase(Node* z, int*)
+{
+    Node* x;
+    Node* xparent;
+    _destroy(_unlink(z, x, xparent));
+    _pull_up(xparent);
+}
+
+//пересчитать крайние узлы спуском от корня
+template<class Data, class Key>
+void Tree<Data, Key>::_fix_ends()
+{
+    first = _min(root);
+    last = _max(root);
+}
+
+//проверка крайних узлов спуском от корня
+template<class Data, class Key>
+bool Tree<Data, Key>::_check_ends()
+{
+    return first == _min(root) && last == _max(root);
+}
+
+//указатель на данные с заданным ключом или NULL, без исключений
+template<class Data, class Key>
+Data* Tree<Data, Key>::find(Key key, int* op)
+{
+    if (op)
+        *op = 0;
+    Node* node = _lookup(key, op);
+    return (node) ? &node->data : NULL;
+}
+
+//проверка наличия ключа
+template<class Data, class Key>
+bool Tree<Data, Key>::contains(Key key, int* op)
+{
+    return find(key, op) != NULL;
+}
+
+//копия данных с заданным ключом
+template<class Data, class Key>
+bool Tree<Data, Key>::try_read(Key key, Data& obj, int* op)
+{
+    Data* data = find(key, op);
+    if (data == NULL)
+        return false;
+    obj = *data;
+    return true;
+}
+
+// Включить фильтр Блума: промахи, отсеянные фильтром, обходятся без спуска по дереву.
+// Фильтр рассчитывается на expected ключей и перестраивается вдвое большим, когда дерево перерастает его вдвое.
+template<class Data, class Key>
+void Tree<Data, Key>::enable_filter(int expected, int bits_per_key)
+{
+    _filter_attach(new BloomFilter<Key>(std::max(expected, length), bits_per_key));
+}
+
+//заменить фильтр пустым и учесть в нем все ключи дерева
+template<class Data, class Key>
+void Tree<Data, Key>::_filter_attach(KeyFilter<Key>* empty)
+{
+    delete filter;
+    filter = empty;
+    for (Node* it = _min(root); it != NULL; it = _next(it))
+        filter->insert(it->key);
+}
+
+//выключить фильтр Блума
+template<class Data, class Key>
+void Tree<Data, Key>::disable_filter()
+{
+    delete filter;
+    filter = NULL;
+}
+
+//поиск узла с предварительной проверкой по фильтру
+template<class Data, class Key>
+typename Tree<Data, Key>::Node* Tree<Data, Key>::_lookup(Key key, int* op)
+{
+    if (filter && !filter->may_contain(key))
+        return NULL;
+    return _find(key, op);
+}
+
+//учесть в фильтре добавленный ключ (ключ уже в дереве)
+template<class Data, class Key>
+void Tree<Data, Key>::_filter_add(Key key)
+{
+    if (!filter)
+        return;
+    if (length > 2 * filter->capacity())
+        _filter_attach(filter->resized(2 * length));
+    else
+        filter->insert(key);
+}
+
+//забыть в фильтре ключи поддерева
+template<class Data, class Key>
+void Tree<Data, Key>::_filter_erase(Node* r)
+{
+    if (!filter || r == NULL)
+        return;
+    _filter_erase(r->left);
+    _filter_erase(r->right);
+    filter->erase(r->key);
+}
+
 //включение данных с заданным ключом
 template<class Data, class Key>
 bool Tree<Data, Key>::add(Key key, Data obj, int* op)
 {
     if (op)
         *op = 0;
-    return _add(key, obj, root, op);
+    if (!_add(key, obj, root, op))
+        return false;
+    if (first == NULL || key < first->key || last->key < key)
+        _fix_ends();
+    _filter_add(key);
+    return true;
 }
 
 //удаление данных с заданным ключом
@@ -261,7 +776,13 @@ bool Tree<Data, Key>::remove(Key key, int* op)
     Node* parent;
     if (op)
         *op = 0;
-    return _remove(key, root, parent, op);
+    if (!_remove(key, root, parent, op))
+        return false;
+    _pull_up(parent);
+    _fix_ends(); // _remove переносит ключи между узлами
+    if (filter)
+        filter->erase(key);
+    return true;
 }
 
 template<class Data, class Key>
@@ -307,88 +828,331 @@ bool Tree<Data, Key>::_remove(Key key, Node*& node, Node*& parent, int* op)
 
 }
 
-//обход структуры по LtR
+//вывод ключей в порядке LtR
 template <class Data, class Key>
-void Tree<Data, Key>::walk()
+void Tree<Data, Key>::walk(ostream& out)
 {
     if (root == NULL)
         throw runtime_error("Нет данных");
 
-    Node* it = root;
-    std::vector<Node*> up(length);
+    BufferedWriter writer(out);
+    ostream buffered(&writer);
+    for_each([&buffered](const Key& key, Data&) {
+        buffered << key << "->";
+        return true;
+    });
+    buffered << '\n';
+    buffered.flush();
+    out.flush();
+}
+
+// Обход LtR со стеком предков фиксированной глубины на стеке вызова: без выделения памяти,
+// каждый узел читается один раз. Стек вмещает путь от корня, поэтому выше STACK_DEPTH уровней
+// (только у несбалансированного базового дерева) обход идет по ссылкам на родителей.
+// visit(key, data) возвращает false, чтобы прервать обход; результат - был ли обход завершен.
+template <class Data, class Key>
+template <class F>
+bool Tree<Data, Key>::for_each(F visit)
+{
+    if (height() > STACK_DEPTH) {
+        for (Node* it = _min(root); it != NULL; it = _next(it))
+            if (!visit(it->key, it->data))
+                return false;
+        return true;
+    }
+
+    Node* stack[STACK_DEPTH];
     int top = 0;
+    Node* it = root;
+    while (it != NULL || top != 0) {
+        while (it != NULL) {
+            stack[top++] = it;
+            it = it->left;
+        }
+        it = stack[--top];
+        if (!visit(it->key, it->data))
+            return false;
+        it = it->right;
+    }
+    return true;
+}
 
-    while (it != NULL) {
+//обход RtL: зеркально for_each
+template <class Data, class Key>
+template <class F>
+bool Tree<Data, Key>::for_each_reverse(F visit)
+{
+    if (height() > STACK_DEPTH) {
+        for (Node* it = _max(root); it != NULL; it = _prev(it))
+            if (!visit(it->key, it->data))
+                return false;
+        return true;
+    }
+
+    Node* stack[STACK_DEPTH];
+    int top = 0;
+    Node* it = root;
+    while (it != NULL || top != 0) {
         while (it != NULL) {
-            if (it->right != NULL)
-                up[top++] = it->right;
+            stack[top++] = it;
+            it = it->right;
+        }
+        it = stack[--top];
+        if (!visit(it->key, it->data))
+            return false;
+        it = it->left;
+    }
+    return true;
+}
 
-            up[top++] = it;
+// Обход LtR ключей из [lo, hi]: при спуске к первому ключу в стек попадают узлы, от которых
+// спуск ушел влево, - это и есть следующие по порядку узлы.
+template <class Data, class Key>
+template <class F>
+bool Tree<Data, Key>::for_each_in_range(Key lo, Key hi, F visit)
+{
+    if (height() > STACK_DEPTH) {
+        for (Node* it = _lower_bound(lo); it != NULL && !(hi < it->key); it = _next(it))
+            if (!visit(it->key, it->data))
+                return false;
+        return true;
+    }
+
+    Node* stack[STACK_DEPTH];
+    int top = 0;
+    Node* it = root;
+    while (it != NULL) {
+        if (it->key < lo)
+            it = it->right;
+        else {
+            stack[top++] = it;
             it = it->left;
         }
+    }
+    while (top != 0) {
+        it = stack[--top];
+        if (hi < it->key)
+            return true;
+        if (!visit(it->key, it->data))
+            return false;
+        for (it = it->right; it != NULL; it = it->left)
+            stack[top++] = it;
+    }
+    return true;
+}
 
-        it = up[--top];
-
-        while (top != 0 && it->right == NULL) {
-            cout << it->key << "->";
-            it = up[--top];
+//первый узел с ключом не меньше заданного
+template <class Data, class Key>
+typename Tree<Data, Key>::Node* Tree<Data, Key>::_lower_bound(Key key)
+{
+    Node* node = root;
+    Node* found = NULL;
+    while (node != NULL) {
+        if (node->key < key)
+            node = node->right;
+        else {
+            found = node;
+            node = node->left;
         }
+    }
+    return found;
+}
 
-        cout << it->key << "->";
+//следующий по ключу узел: минимум правого поддерева или первый предок, в левом поддереве которого x
+template <class Data, class Key>
+typename Tree<Data, Key>::Node* Tree<Data, Key>::_next(Node* x)
+{
+    if (x == NULL)
+        return NULL;
+    if (x->right != NULL) {
+        x = x->right;
+        while (x->left != NULL)
+            x = x->left;
+        return x;
+    }
+    while (x->parent != NULL && x->parent->right == x)
+        x = x->parent;
+    return x->parent;
+}
 
-        if (top == 0)
-            break;
+//поиск минимального по ключу узла в поддереве
+template <class Data, class Key>
+typename Tree<Data, Key>::Node* Tree<Data, Key>::_min(Node* t, int* op)
+{
+    if (t == NULL)
+        return NULL;
+    while (t->left != NULL) {
+        t = t->left;
+        if (op)
+            ++*op;
+    }
+    return t;
+}
 
-        it = up[--top];
+//поиск максимального по ключу узла в поддереве
+template <class Data, class Key>
+typename Tree<Data, Key>::Node* Tree<Data, Key>::_max(Node* t, int* op)
+{
+    if (t == NULL)
+        return NULL;
+    while (t->right != NULL) {
+        t = t->right;
+        if (op)
+            ++*op;
     }
-    cout << endl;
+    return t;
+}
+
+//предыдущий по ключу узел
+template <class Data, class Key>
+typename Tree<Data, Key>::Node* Tree<Data, Key>::_prev(Node* x)
+{
+    if (x == NULL)
+        return NULL;
+    if (x->left != NULL) {
+        x = x->left;
+        while (x->right != NULL)
+            x = x->right;
+        return x;
+    }
+    while (x->parent != NULL && x->parent->left == x)
+        x = x->parent;
+    return x->parent;
 }
 
 //вспомогательная функция для вывода структуры
 template <class Data, class Key>
-void Tree<Data, Key>::_show(typename Tree<Data, Key>::Node* r, int level)
+void Tree<Data, Key>::_show(typename Tree<Data, Key>::Node* r, int level, ostream& out)
 {
     if (r == NULL)
         return;
-    _show(r->right, level + 1);
+    _show(r->right, level + 1, out);
     for (int i = 0; i <= 2 * level; i++)
-        cout << " ";
-    cout << r->key << endl;
-    _show(r->left, level + 1);
+        out << " ";
+    out << r->key << '\n';
+    _show(r->left, level + 1, out);
 }
 
-//вывод структуры дерева на экран
+//вывод структуры дерева в поток
 template<class Data, class Key>
-void Tree<Data, Key>::print()
+void Tree<Data, Key>::print(ostream& out)
 {
     if (root == NULL) {
         return;
     }
-    _show(root, 0);
+    BufferedWriter writer(out);
+    ostream buffered(&writer);
+    _show(root, 0, buffered);
+    buffered.flush();
+    out.flush();
 }
 
 
-//определение длины внешнего пути дерева 
+//определение длины внешнего пути дерева
 template<class Data, class Key>
-int Tree<Data, Key>::external_path_length()
+long long Tree<Data, Key>::external_path_length()
 {
     if (root == NULL)
         return -1;
-    int sum = 0;
-    _count_level(root, 1, sum);
-    return sum;
+    return root->ext_sum;
 }
 
-//вспомогательная функция для определения внешнего пути
+//высота дерева
+template<class Data, class Key>
+int Tree<Data, Key>::height()
+{
+    return (root) ? root->levels : 0;
+}
+
+//число листьев
+template<class Data, class Key>
+int Tree<Data, Key>::leaf_count()
+{
+    return (root) ? root->leaves : 0;
+}
+
+//средний уровень узла
+template<class Data, class Key>
+double Tree<Data, Key>::average_depth()
+{
+    if (root == NULL)
+        return 0;
+    return (double)root->depth_sum / root->count;
+}
+
+// Оценка среднего уровня по методу Кнута: каждый спуск от корня выбирает случайного сына,
+// а узел на пути учитывается с весом, равным произведению степеней ветвления выше него.
+// Не использует статистику узлов, стоимость O(samples * высота).
+template<class Data, class Key>
+double Tree<Data, Key>::estimate_depth(int samples)
+{
+    if (root == NULL || samples <= 0)
+        return 0;
+    double nodes = 0, levels = 0;
+    for (int i = 0; i < samples; i++) {
+        Node* it = root;
+        double weight = 1;
+        for (int level = 1; it != NULL; level++) {
+            nodes += weight;
+            levels += weight * level;
+            if (it->left != NULL && it->right != NULL) {
+                weight *= 2;
+                it = (rand() % 2) ? it->left : it->right;
+            } else
+                it = (it->left != NULL) ? it->left : it->right;
+        }
+    }
+    return levels / nodes;
+}
+
+//число поворотов, выполненных балансировкой
+template<class Data, class Key>
+int Tree<Data, Key>::rotation_count()
+{
+    return rotations;
+}
+
+//пересчитать статистику узла в предположении, что статистика сыновей верна
 template <class Data, class Key>
-void Tree<Data, Key>::_count_level(Node* r, int level, int& sum)
+void Tree<Data, Key>::_pull(Node* node)
+{
+    Node* sons[2] = { node->left, node->right };
+    node->count = node->levels = node->depth_sum = 1;
+    node->leaves = (sons[0] == NULL && sons[1] == NULL) ? 1 : 0;
+    node->ext_sum = (sons[0] != NULL && sons[1] != NULL) ? 0 : 1;
+    for (int i = 0; i < 2; i++) {
+        Node* son = sons[i];
+        if (son == NULL)
+            continue;
+        node->count += son->count;
+        node->leaves += son->leaves;
+        node->levels = std::max(node->levels, son->levels + 1);
+        node->depth_sum += son->depth_sum + son->count;
+        // узлов с менее чем двумя сыновьями в поддереве на один больше, чем узлов с двумя
+        node->ext_sum += son->ext_sum + (son->count - son->leaves + 1);
+    }
+}
+
+//пересчитать статистику от узла до корня
+template <class Data, class Key>
+void Tree<Data, Key>::_pull_up(Node* node)
+{
+    for (; node != NULL; node = node->parent)
+        _pull(node);
+}
+
+//проверка статистики поддерева полным пересчетом
+template <class Data, class Key>
+bool Tree<Data, Key>::_check_stats(Node* r)
 {
     if (r == NULL)
-        return;
-    _count_level(r->left, level + 1, sum);
-    _count_level(r->right, level + 1, sum);
-    if (r->right == NULL || r->left == NULL)
-        sum += level;
+        return true;
+    if (!_check_stats(r->left) || !_check_stats(r->right))
+        return false;
+    Node copy = *r;
+    _pull(&copy);
+    return copy.count == r->count && copy.leaves == r->leaves && copy.levels == r->levels
+        && copy.depth_sum == r->depth_sum && copy.ext_sum == r->ext_sum;
 }
 
 template <class Data, class Key> 
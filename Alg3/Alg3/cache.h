@@ -0,0 +1,368 @@
+#pragma once
+
+#include "avl.h"
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <exception>
+#include <unordered_map>
+
+
+using namespace std;
+
+// Узел кэша: узел дерева с полями списка вытеснения. Такие узлы выделяет только CacheTree,
+// поэтому остальные деревья за эти поля не платят.
+template<class Data, class Key>
+class CacheNode: public TNode<Data, Key>
+{
+public:
+    CacheNode<Data, Key>* newer;                    //более новый узел в списке вытеснения
+    CacheNode<Data, Key>* older;                    //более старый узел в списке вытеснения
+    int hits;                                       //число обращений (для вытеснения LFU)
+    int cost;                                       //вклад в заполнение кэша
+    CacheNode(Data d, Key k) : TNode<Data, Key>(d, k) { //конструктор с параметрами
+        newer = older = NULL;
+        hits = cost = 0;
+    }
+};
+
+// Кэш ограниченной емкости на AVL-дереве. Узлы связаны в интрузивный список вытеснения
+// (поля newer/older узла) от самого старого к самому новому, поэтому выбор жертвы - O(1).
+// LRU: при обращении узел переносится в новый конец списка.
+// LFU: список упорядочен по числу обращений, при равенстве - по давности; для каждого
+// числа обращений хранится последний узел с этим числом, так что перенос тоже O(1).
+template <class Data, class Key> class CacheTree: public AVLTree<Data, Key> {
+
+public:
+    typedef TNode<Data, Key> Node;
+    typedef CacheNode<Data, Key> Entry;
+
+    enum Policy { LRU, LFU };                               //порядок вытеснения
+    enum Limit { ENTRIES, BYTES };                          //единица емкости
+
+    CacheTree(long long capacity, Policy policy = LRU, Limit limit = ENTRIES,
+              int (*weigh)(const Key&, const Data&) = NULL); //конструктор с емкостью и оценкой размера записи
+    ~CacheTree(void);                                       //деструктор
+    CacheTree(const CacheTree<Data, Key>&) = delete;
+    CacheTree<Data, Key>& operator=(const CacheTree<Data, Key>&) = delete;
+
+    virtual Data& read(Key key, int* op = NULL);            //доступ к данным с учетом попаданий и промахов
+    virtual Data* find(Key key, int* op = NULL);            //указатель на данные или NULL с учетом попаданий и промахов (contains и try_read идут через него)
+    virtual bool add(Key key, Data obj, int* op = NULL);    //включение данных с предварительным вытеснением
+    virtual bool remove(Key key, int* op = NULL);           //удаление данных с заданным ключом
+    int transfer(Key lo, Key hi, AVLTree<Data, Key>& target, int* op = NULL) = delete; //перенос узлов разорвал бы список вытеснения
+    long long capacity();                                   //емкость
+    long long used();                                       //заполнение
+    int hit_count();                                        //число попаданий
+    int miss_count();                                       //число промахов
+    int eviction_count();                                   //число вытесненных записей
+    bool check();                                           //проверка дерева и списка вытеснения на корректность
+
+private:
+    long long bound;                                        //емкость
+    long long fill;                                         //заполнение
+    Policy policy;                                          //порядок вытеснения
+    Limit limit;                                            //единица емкости
+    int (*weigh)(const Key&, const Data&);                  //размер записи в байтах (NULL - размер узла)
+    Entry* oldest;                                          //первый кандидат на вытеснение
+    Entry* newest;                                          //последний кандидат на вытеснение
+    unordered_map<int, Entry*> last_of;                     //LFU: последний в списке узел с данным числом обращений
+    int hit_counter;                                        //число попаданий
+    int miss_counter;                                       //число промахов
+    int eviction_counter;                                   //число вытесненных записей
+
+    int _cost(Key key, Data& data);                         //вклад записи в заполнение
+    void _link(Entry* node);                                //поставить новый узел в список вытеснения
+    void _touch(Entry* node);                               //учесть обращение к узлу
+    void _forget(Entry* node);                              //убрать узел из списка вытеснения
+    void _detach(Entry* node);                              //исключить узел из списка
+    void _insert_after(Entry* node, Entry* after);          //вставить узел после after (NULL - в старый конец)
+    void _evict(int room);                                  //вытеснять, пока запись стоимостью room не помещается
+
+protected:
+    virtual Node* _create(Key key, Data obj);               //выделение узла кэша
+    virtual void _destroy(Node* node);                      //освобождение узла кэша вместе с его записью в списке вытеснения
+    virtual bool _movable();                                //узлы кэша связаны списком вытеснения и не переносятся
+};
+
+//конструктор с емкостью
+template<class Data, class Key>
+CacheTree<Data, Key>::CacheTree(long long capacity, Policy policy, Limit limit, int (*weigh)(const Key&, const Data&))
+{
+    bound = capacity;
+    fill = 0;
+    this->policy = policy;
+    this->limit = limit;
+    this->weigh = weigh;
+    oldest = newest = NULL;
+    hit_counter = miss_counter = eviction_counter = 0;
+}
+
+//деструктор
+template<class Data, class Key>
+CacheTree<Data, Key>::~CacheTree(void)
+{
+    this->clear(); // в деструкторе Tree вызов _destroy уже не дошел бы до CacheTree
+}
+
+//емкость
+template<class Data, class Key>
+long long CacheTree<Data, Key>::capacity()
+{
+    return bound;
+}
+
+//заполнение
+template<class Data, class Key>
+long long CacheTree<Data, Key>::used()
+{
+    return fill;
+}
+
+//число попаданий
+template<class Data, class Key>
+int CacheTree<Data, Key>::hit_count()
+{
+    return hit_counter;
+}
+
+//число промахов
+template<class Data, class Key>
+int CacheTree<Data, Key>::miss_count()
+{
+    return miss_counter;
+}
+
+//число вытесненных записей
+template<class Data, class Key>
+int CacheTree<Data, Key>::eviction_count()
+{
+    return eviction_counter;
+}
+
+//вклад записи в заполнение
+template<class Data, class Key>
+int CacheTree<Data, Key>::_cost(Key key, Data& data)
+{
+    if (limit == ENTRIES)
+        return 1;
+    return (weigh) ? weigh(key, data) : (int)sizeof(Entry);
+}
+
+//доступ к данным с заданным ключом
+template<class Data, class Key>
+Data& CacheTree<Data, Key>::read(Key key, int* op)
+{
+    Data* data = find(key, op);
+    if (data == NULL)
+        throw runtime_error("Узел с таким ключом отсутствует");
+    return *data;
+}
+
+//указатель на данные с заданным ключом или NULL
+template<class Data, class Key>
+Data* CacheTree<Data, Key>::find(Key key, int* op)
+{
+    if (op)
+        *op = 0;
+    Entry* node = static_cast<Entry*>(this->_lookup(key, op));
+    if (node == NULL) {
+        miss_counter++;
+        return NULL;
+    }
+    hit_counter++;
+    _touch(node);
+    return &node->data;
+}
+
+//включение данных с заданным ключом
+template<class Data, class Key>
+bool CacheTree<Data, Key>::add(Key key, Data obj, int* op)
+{
+    if (op)
+        *op = 0;
+    int cost = _cost(key, obj);
+    if (cost > bound) // запись не поместится даже в пустой кэш
+        return false;
+    Entry* node = static_cast<Entry*>(this->_insert(key, obj, op));
+    if (!node) // не добавлен
+        return false;
+
+    _evict(cost); // новый узел еще не в списке, поэтому жертвой стать не может
+    node->cost = cost;
+    fill += cost;
+    _link(node);
+    return true;
+}
+
+//удаление данных с заданным ключом
+template<class Data, class Key>
+bool CacheTree<Data, Key>::remove(Key key, int* op)
+{
+    if (op)
+        *op = 0;
+    Node* node = this->_find(key, op);
+    if (!node) // не удален
+        return false;
+
+    this->_erase(node, op);
+    return true;
+}
+
+//вытеснять, пока запись стоимостью room не помещается
+template<class Data, class Key>
+void CacheTree<Data, Key>::_evict(int room)
+{
+    while (fill + room > bound && oldest != NULL) {
+        this->_erase(oldest);
+        eviction_counter++;
+    }
+}
+
+//выделение узла кэша
+template<class Data, class Key>
+TNode<Data, Key>* CacheTree<Data, Key>::_create(Key key, Data obj)
+{
+    return new Entry(obj, key);
+}
+
+// Освобождение узла кэша. Через _destroy проходят все удаления дерева (remove, pop_min, clear,
+// remove_range, remove_if), в том числе вызванные через ссылку на AVLTree, поэтому запись
+// убирается из списка вытеснения здесь.
+template<class Data, class Key>
+void CacheTree<Data, Key>::_destroy(Node* node)
+{
+    Entry* entry = static_cast<Entry*>(node);
+    _forget(entry);
+    delete entry;
+}
+
+//узлы кэша не переносятся в другие деревья
+template<class Data, class Key>
+bool CacheTree<Data, Key>::_movable()
+{
+    return false;
+}
+
+//поставить новый узел в список: LRU - в новый конец, LFU - за последним узлом с одним обращением
+template<class Data, class Key>
+void CacheTree<Data, Key>::_link(Entry* node)
+{
+    node->hits = 1;
+    if (policy == LRU) {
+        _insert_after(node, newest);
+        return;
+    }
+    typename unordered_map<int, Entry*>::iterator once = last_of.find(1);
+    _insert_after(node, (once != last_of.end()) ? once->second : NULL);
+    last_of[1] = node;
+}
+
+// Учесть обращение к узлу. LFU: узел с f обращениями переносится за последний узел с f + 1
+// обращениями, а если таких нет - за последний узел с f обращениями.
+template<class Data, class Key>
+void CacheTree<Data, Key>::_touch(Entry* node)
+{
+    int f = node->hits;
+    node->hits = f + 1;
+    if (policy == LRU) {
+        if (node != newest) {
+            _detach(node);
+            _insert_after(node, newest);
+        }
+        return;
+    }
+
+    typename unordered_map<int, Entry*>::iterator next = last_of.find(f + 1);
+    typename unordered_map<int, Entry*>::iterator same = last_of.find(f);
+    Entry* target = (next != last_of.end()) ? next->second : same->second;
+    if (same->second == node) {
+        if (node->older != NULL && node->older->hits == f)
+            same->second = node->older;
+        else
+            last_of.erase(same);
+    }
+    if (target != node) {
+        _detach(node);
+        _insert_after(node, target);
+    }
+    last_of[f + 1] = node;
+}
+
+//убрать узел из списка вытеснения
+template<class Data, class Key>
+void CacheTree<Data, Key>::_forget(Entry* node)
+{
+    if (policy == LFU) {
+        typename unordered_map<int, Entry*>::iterator same = last_of.find(node->hits);
+        if (same->second == node) {
+            if (node->older != NULL && node->older->hits == node->hits)
+                same->second = node->older;
+            else
+                last_of.erase(same);
+        }
+    }
+    _detach(node);
+    fill -= node->cost;
+}
+
+//исключить узел из списка
+template<class Data, class Key>
+void CacheTree<Data, Key>::_detach(Entry* node)
+{
+    if (node->older != NULL)
+        node->older->newer = node->newer;
+    else
+        oldest = node->newer;
+    if (node->newer != NULL)
+        node->newer->older = node->older;
+    else
+        newest = node->older;
+    node->newer = node->older = NULL;
+}
+
+//вставить узел после after (NULL - в старый конец)
+template<class Data, class Key>
+void CacheTree<Data, Key>::_insert_after(Entry* node, Entry* after)
+{
+    node->older = after;
+    node->newer = (after != NULL) ? after->newer : oldest;
+    if (node->newer != NULL)
+        node->newer->older = node;
+    else
+        newest = node;
+    if (after != NULL)
+        after->newer = node;
+    else
+        oldest = node;
+}
+
+//проверка дерева и списка вытеснения на корректность
+template<class Data, class Key>
+bool CacheTree<Data, Key>::check()
+{
+    if (!AVLTree<Data, Key>::check())
+        return false;
+    int count = 0;
+    long long total = 0;
+    for (Entry* it = oldest; it != NULL; it = it->newer) {
+        if (it->newer != NULL ? it->newer->older != it : newest != it)
+            return false;
+        if (this->_find(it->key) != it)
+            return false;
+        if (policy == LFU) {
+            if (it->newer != NULL && it->newer->hits < it->hits)
+                return false;
+            bool last = (it->newer == NULL || it->newer->hits != it->hits);
+            typename unordered_map<int, Entry*>::iterator mark = last_of.find(it->hits);
+            if (last != (mark != last_of.end() && mark->second == it))
+                return false;
+        }
+        count++;
+        total += it->cost;
+    }
+    if (policy == LFU && last_of.size() > (size_t)count)
+        return false;
+    return count == this->length && total == fill && fill <= std::max(bound, 0LL);
+}
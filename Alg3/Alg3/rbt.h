@@ -0,0 +1,264 @@
+#pragma once
+
+#include "bst.h"
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <exception>
+
+
+using namespace std;
+
+// Красно-черное дерево. Цвет узла хранится в поле height: 1 - красный, 0 - черный.
+// Пустые сыновья считаются черными.
+template <class Data, class Key> class RBTree: public Tree<Data, Key> {
+
+public:
+    typedef TNode<Data, Key> Node;
+
+    RBTree();                                               //конструктор без параметров
+    ~RBTree(void);                                          //деструктор
+
+    virtual bool add(Key key, Data obj, int* op = NULL);    //включение данных с заданным ключом
+    virtual bool remove(Key key, int* op = NULL);           //удаление данных с заданным ключом
+    bool check();                                           //проверка структуры узлов на корректность
+
+protected:
+    virtual void _erase(Node* z, int* op = NULL);           //удаление узла z с балансировкой и освобождением
+
+private:
+    enum { BLACK = 0, RED = 1 };
+
+    virtual void _show(Node* r, int level, ostream& out);   //вспомогательная функция для вывода структуры
+
+    int _check(Node* node);                                 //черная высота поддерева или -1, если оно некорректно
+    int _color(Node* node);                                 //цвет узла (пустой узел - черный)
+    void _add_fixup(Node* z, int* op = NULL);               //восстановление свойств после добавления z
+    void _remove_fixup(Node* x, Node* xparent, int* op = NULL); //восстановление свойств после удаления черного узла
+};
+
+//конструктор без параметров
+template<class Data, class Key>
+RBTree<Data, Key>::RBTree(void)
+{
+}
+
+//деструктор
+template<class Data, class Key>
+RBTree<Data, Key>::~RBTree(void)
+{
+}
+
+//цвет узла
+template<class Data, class Key>
+int RBTree<Data, Key>::_color(Node* node)
+{
+    return (node) ? node->height : BLACK;
+}
+
+//проверка корректности дерева
+template<class Data, class Key>
+bool RBTree<Data, Key>::check()
+{
+    if (!this->root)
+        return this->_check_ends();
+    if (this->root->parent || this->root->height != BLACK)
+        return false;
+    return _check(this->root) != -1 && this->_check_stats(this->root) && this->_check_ends();
+}
+
+// проверка на корректность структуры дерева: ссылки на родителей и детей взаимно согласованы,
+// у красного узла нет красных сыновей, черная высота всех путей одинакова.
+template<class Data, class Key>
+int RBTree<Data, Key>::_check(Node* node)
+{
+    if (!node)
+        return 0;
+    if (node->height != RED && node->height != BLACK)
+        return -1;
+    if (node->left && (node->left->parent != node || !(node->left->key < node->key)))
+        return -1;
+    if (node->right && (node->right->parent != node || !(node->key < node->right->key)))
+        return -1;
+    if (node->height == RED && (_color(node->left) == RED || _color(node->right) == RED))
+        return -1;
+    int lblack = _check(node->left);
+    int rblack = _check(node->right);
+    if (lblack == -1 || lblack != rblack)
+        return -1;
+    return lblack + (node->height == BLACK ? 1 : 0);
+}
+
+//вспомогательная функция для вывода структуры
+template <class Data, class Key>
+void RBTree<Data, Key>::_show(Node* r, int level, ostream& out)
+{
+    if (r == NULL)
+        return;
+    _show(r->right, level + 1, out);
+    for (int i = 0; i <= 2 * level; i++)
+        out << " ";
+    out << r->key << "," << (r->height == RED ? "R" : "B") << '\n';
+    _show(r->left, level + 1, out);
+}
+
+// добавление элемента: лист вставляется красным, затем устраняется нарушение "красный под красным"
+template<class Data, class Key>
+bool RBTree<Data, Key>::add(Key key, Data data, int* op)
+{
+    if (op)
+        *op = 0;
+    Node* new_node = this->_just_add(key, data, op);
+    if (!new_node) // не добавлен
+        return false;
+
+    new_node->height = RED;
+    _add_fixup(new_node, op);
+    this->_pull_up(new_node);
+    return true;
+}
+
+// Инвариант цикла: единственное нарушение - красный z с красным родителем.
+// Красный дядя - перекрашивание и подъем на два уровня, черный дядя - не более двух поворотов и выход.
+template<class Data, class Key>
+void RBTree<Data, Key>::_add_fixup(Node* z, int* op)
+{
+    while (z->parent && z->parent->height == RED) {
+        if (op)
+            ++*op;
+
+        Node* p = z->parent;
+        Node* g = p->parent; // существует, так как корень черный
+        if (p == g->left) {
+            Node* u = g->right;
+            if (_color(u) == RED) {
+                p->height = BLACK;
+                u->height = BLACK;
+                g->height = RED;
+                z = g;
+                continue;
+            }
+            if (z == p->right) {
+                this->_rotate_left(p);
+                z = p;
+                p = z->parent;
+            }
+            p->height = BLACK;
+            g->height = RED;
+            this->_rotate_right(g);
+        } else {
+            Node* u = g->left;
+            if (_color(u) == RED) {
+                p->height = BLACK;
+                u->height = BLACK;
+                g->height = RED;
+                z = g;
+                continue;
+            }
+            if (z == p->left) {
+                this->_rotate_right(p);
+                z = p;
+                p = z->parent;
+            }
+            p->height = BLACK;
+            g->height = RED;
+            this->_rotate_left(g);
+        }
+    }
+    this->root->height = BLACK;
+}
+
+//удаление данных с заданным ключом
+template<class Data, class Key>
+bool RBTree<Data, Key>::remove(Key key, int* op)
+{
+    if (op)
+        *op = 0;
+
+    Node* z = this->_find(key, op);
+    if (!z) // не удален
+        return false;
+
+    _erase(z, op);
+    return true;
+}
+
+// удаление узла z: если освобожденная позиция была черной, на месте x не хватает одного черного
+template<class Data, class Key>
+void RBTree<Data, Key>::_erase(Node* z, int* op)
+{
+    Node* x;
+    Node* xparent;
+    Node* y = this->_unlink(z, x, xparent);
+    bool black = (y->height == BLACK);
+    this->_destroy(y);
+
+    if (black)
+        _remove_fixup(x, xparent, op);
+    this->_pull_up(xparent);
+}
+
+// Инвариант цикла: x "дважды черный". Красный брат сводится поворотом к черному;
+// черный брат с черными сыновьями - перекрашивание и подъем, иначе не более двух поворотов и выход.
+template<class Data, class Key>
+void RBTree<Data, Key>::_remove_fixup(Node* x, Node* xparent, int* op)
+{
+    while (x != this->root && _color(x) == BLACK) {
+        if (op)
+            ++*op;
+
+        if (x == xparent->left) {
+            Node* w = xparent->right;
+            if (w->height == RED) {
+                w->height = BLACK;
+                xparent->height = RED;
+                this->_rotate_left(xparent);
+                w = xparent->right;
+            }
+            if (_color(w->left) == BLACK && _color(w->right) == BLACK) {
+                w->height = RED;
+                x = xparent;
+                xparent = x->parent;
+                continue;
+            }
+            if (_color(w->right) == BLACK) {
+                w->left->height = BLACK;
+                w->height = RED;
+                this->_rotate_right(w);
+                w = xparent->right;
+            }
+            w->height = xparent->height;
+            xparent->height = BLACK;
+            w->right->height = BLACK;
+            this->_rotate_left(xparent);
+        } else {
+            Node* w = xparent->left;
+            if (w->height == RED) {
+                w->height = BLACK;
+                xparent->height = RED;
+                this->_rotate_right(xparent);
+                w = xparent->left;
+            }
+            if (_color(w->left) == BLACK && _color(w->right) == BLACK) {
+                w->height = RED;
+                x = xparent;
+                xparent = x->parent;
+                continue;
+            }
+            if (_color(w->left) == BLACK) {
+                w->right->height = BLACK;
+                w->height = RED;
+                this->_rotate_left(w);
+                w = xparent->left;
+            }
+            w->height = xparent->height;
+            xparent->height = BLACK;
+            w->left->height = BLACK;
+            this->_rotate_right(xparent);
+        }
+        x = this->root;
+    }
+    if (x)
+        x->height = BLACK;
+}
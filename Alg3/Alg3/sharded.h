@@ -0,0 +1,370 @@
+#pragma once
+
+#include "avl.h"
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+
+
+using namespace std;
+
+// Сегментированное дерево: пространство ключей разбито границами на N диапазонов,
+// каждый диапазон хранится в отдельном AVL-дереве со своей блокировкой.
+// Сегмент i содержит ключи из [bounds[i-1], bounds[i]).
+// Операции add/remove/read/scan берут разделяемую блокировку границ и блокировку одного сегмента,
+// перенос границ (rebalance) берет исключительную блокировку границ.
+template <class Data, class Key> class ShardedTree {
+
+public:
+    typedef AVLTree<Data, Key> Shard;
+
+    ShardedTree(const vector<Key>& bounds, double skew = 2.0); //конструктор по N-1 возрастающим границам сегментов
+    ~ShardedTree(void);                                        //деструктор
+    ShardedTree(const ShardedTree<Data, Key>&) = delete;
+    ShardedTree<Data, Key>& operator=(const ShardedTree<Data, Key>&) = delete;
+
+    int size();                                                //опрос размера
+    bool empty();                                              //проверка на пустоту
+    void clear();                                              //очистка всех сегментов
+    Data read(Key key, int* op = NULL);                        //копия данных с заданным ключом
+    bool add(Key key, Data obj, int* op = NULL);               //включение данных с заданным ключом
+    bool remove(Key key, int* op = NULL);                      //удаление данных с заданным ключом
+    template<class F> void scan(Key lo, Key hi, F visit);      //вызов visit(key, data) для ключей из [lo, hi] по возрастанию
+    void rebalance();                                          //выравнивание размеров сегментов переносом границ
+    int shards();                                              //число сегментов
+    int shard_size(int i);                                     //размер сегмента i
+    bool check();                                              //проверка сегментов и границ на корректность
+
+private:
+    struct Segment {
+        Shard tree;             //дерево сегмента
+        mutex lock;             //блокировка сегмента
+    };
+
+    vector<Key> bounds;         //границы сегментов
+    vector<Segment*> segments;  //сегменты по возрастанию ключей
+    shared_timed_mutex bounds_lock; //блокировка границ
+    atomic<int> length;         //общее число элементов
+    double skew;                //допустимое отношение размера сегмента к среднему (0 - без автоматического переноса)
+
+    int _route(Key key);                        //номер сегмента, которому принадлежит ключ
+    bool _skewed(int i);                        //сегмент i слишком велик по сравнению со средним
+    void _rebalance(double limit);              //переносить границы, пока наибольший сегмент больше limit
+    void _move(int from, int to, int count);    //перенести count крайних элементов в соседний сегмент целым поддеревом
+
+public:
+    // Итератор все время жизни держит разделяемую блокировку границ и блокировку текущего сегмента,
+    // поэтому перенос границ и изменения текущего сегмента ждут его уничтожения, а узлы под ним
+    // не освобождаются. Поток, владеющий итератором, не должен вызывать другие методы дерева
+    // (блокировки не рекурсивны); для коротких обходов удобнее scan.
+    class Iterator
+    {
+    private:
+        ShardedTree* ptr;                      //указатель на объект коллекции
+        shared_lock<shared_timed_mutex> guard; //разделяемая блокировка границ
+        unique_lock<mutex> lock;               //блокировка текущего сегмента
+        int shard;                             //номер текущего сегмента
+        typename Shard::Iterator it;           //итератор внутри сегмента
+    public:
+        //конструктор
+        Iterator(ShardedTree<Data, Key>& tree)
+            : ptr(&tree), guard(tree.bounds_lock), lock(tree.segments[0]->lock), shard(0), it(tree.segments[0]->tree) {
+        }
+
+        //установка на первый
+        void begin() {
+            _open(0);
+            it.begin();
+            _skip_forward();
+        }
+
+        //установка на последний
+        void end() {
+            _open((int)ptr->segments.size() - 1);
+            it.end();
+            _skip_backward();
+        }
+
+        //установка на первый элемент с ключом не меньше заданного
+        void seek(Key key) {
+            _open(ptr->_route(key));
+            it.seek(key);
+            _skip_forward();
+        }
+
+        //установка на следующий
+        void next() {
+            it.next();
+            _skip_forward();
+        }
+
+        //установка на предыдущий
+        void prev() {
+            it.prev();
+            _skip_backward();
+        }
+
+        //проверка состояния итератора
+        bool is_off() const {
+            return it.is_off();
+        }
+
+        //доступ к данным текущего элемента
+        Data& operator*() {
+            return *it;
+        }
+
+        //ключ текущего элемента
+        Key key() const {
+            return it.key();
+        }
+
+    private:
+        //перейти в сегмент i, сменив блокировку сегмента
+        void _open(int i) {
+            if (i != shard) {
+                lock.unlock();
+                lock = unique_lock<mutex>(ptr->segments[i]->lock);
+                shard = i;
+            }
+            it = typename Shard::Iterator(ptr->segments[i]->tree);
+        }
+
+        //при выходе за сегмент перейти на первый элемент следующих сегментов
+        void _skip_forward() {
+            while (it.is_off() && shard + 1 < (int)ptr->segments.size()) {
+                _open(shard + 1);
+                it.begin();
+            }
+        }
+
+        //при выходе за сегмент перейти на последний элемент предыдущих сегментов
+        void _skip_backward() {
+            while (it.is_off() && shard > 0) {
+                _open(shard - 1);
+                it.end();
+            }
+        }
+    };
+
+    friend class Iterator;
+};
+
+//конструктор по границам сегментов
+template<class Data, class Key>
+ShardedTree<Data, Key>::ShardedTree(const vector<Key>& bounds, double skew)
+    : bounds(bounds), length(0), skew(skew)
+{
+    for (size_t i = 1; i < bounds.size(); i++)
+        if (!(bounds[i - 1] < bounds[i]))
+            throw runtime_error("Границы сегментов должны возрастать");
+    for (size_t i = 0; i <= bounds.size(); i++)
+        segments.push_back(new Segment());
+}
+
+//деструктор
+template<class Data, class Key>
+ShardedTree<Data, Key>::~ShardedTree(void)
+{
+    for (size_t i = 0; i < segments.size(); i++)
+        delete segments[i];
+}
+
+//опрос размера
+template<class Data, class Key>
+int ShardedTree<Data, Key>::size()
+{
+    return length;
+}
+
+//проверка на пустоту
+template<class Data, class Key>
+bool ShardedTree<Data, Key>::empty()
+{
+    return length == 0;
+}
+
+//очистка всех сегментов
+template<class Data, class Key>
+void ShardedTree<Data, Key>::clear()
+{
+    unique_lock<shared_timed_mutex> guard(bounds_lock);
+    for (size_t i = 0; i < segments.size(); i++)
+        segments[i]->tree.clear();
+    length = 0;
+}
+
+//число сегментов
+template<class Data, class Key>
+int ShardedTree<Data, Key>::shards()
+{
+    return (int)segments.size();
+}
+
+//размер сегмента i
+template<class Data, class Key>
+int ShardedTree<Data, Key>::shard_size(int i)
+{
+    shared_lock<shared_timed_mutex> guard(bounds_lock);
+    lock_guard<mutex> lock(segments[i]->lock);
+    return segments[i]->tree.size();
+}
+
+//номер сегмента: число границ, не превосходящих ключ
+template<class Data, class Key>
+int ShardedTree<Data, Key>::_route(Key key)
+{
+    return (int)(upper_bound(bounds.begin(), bounds.end(), key) - bounds.begin());
+}
+
+//сегмент i слишком велик по сравнению со средним (мелкие сегменты не переносятся)
+template<class Data, class Key>
+bool ShardedTree<Data, Key>::_skewed(int i)
+{
+    int n = segments[i]->tree.size();
+    return skew > 0 && n > 64 && n > skew * length / (int)segments.size();
+}
+
+//копия данных с заданным ключом (ссылка на данные сегмента могла бы пережить блокировку)
+template<class Data, class Key>
+Data ShardedTree<Data, Key>::read(Key key, int* op)
+{
+    shared_lock<shared_timed_mutex> guard(bounds_lock);
+    Segment* segment = segments[_route(key)];
+    lock_guard<mutex> lock(segment->lock);
+    return segment->tree.read(key, op);
+}
+
+//включение данных с заданным ключом; перекошенные сегменты выравниваются после снятия блокировок
+template<class Data, class Key>
+bool ShardedTree<Data, Key>::add(Key key, Data obj, int* op)
+{
+    bool skewed = false;
+    {
+        shared_lock<shared_timed_mutex> guard(bounds_lock);
+        int i = _route(key);
+        lock_guard<mutex> lock(segments[i]->lock);
+        if (!segments[i]->tree.add(key, obj, op))
+            return false;
+        length++;
+        skewed = _skewed(i);
+    }
+    if (skewed) {
+        unique_lock<shared_timed_mutex> guard(bounds_lock);
+        _rebalance(skew * length / (int)segments.size());
+    }
+    return true;
+}
+
+//удаление данных с заданным ключом
+template<class Data, class Key>
+bool ShardedTree<Data, Key>::remove(Key key, int* op)
+{
+    shared_lock<shared_timed_mutex> guard(bounds_lock);
+    Segment* segment = segments[_route(key)];
+    lock_guard<mutex> lock(segment->lock);
+    if (!segment->tree.remove(key, op))
+        return false;
+    length--;
+    return true;
+}
+
+//обход ключей из [lo, hi] по возрастанию с последовательной блокировкой сегментов
+template<class Data, class Key>
+template<class F>
+void ShardedTree<Data, Key>::scan(Key lo, Key hi, F visit)
+{
+    shared_lock<shared_timed_mutex> guard(bounds_lock);
+    for (int i = _route(lo); i < (int)segments.size(); i++) {
+        if (i > 0 && hi < bounds[i - 1])
+            break;
+        lock_guard<mutex> lock(segments[i]->lock);
+        typename Shard::Iterator it(segments[i]->tree);
+        for (it.seek(lo); !it.is_off() && !(hi < it.key()); it.next())
+            visit(it.key(), *it);
+    }
+}
+
+//выравнивание размеров сегментов переносом границ
+template<class Data, class Key>
+void ShardedTree<Data, Key>::rebalance()
+{
+    unique_lock<shared_timed_mutex> guard(bounds_lock);
+    _rebalance((double)length / (int)segments.size());
+}
+
+// Пока наибольший сегмент больше limit, выбираем пару соседних сегментов с наибольшей разностью
+// размеров и переносим половину разности через их общую границу. Сумма квадратов размеров
+// при каждом переносе строго убывает, поэтому цикл конечен. Вызывается под исключительной блокировкой границ.
+template<class Data, class Key>
+void ShardedTree<Data, Key>::_rebalance(double limit)
+{
+    int n = (int)segments.size();
+    while (n > 1) {
+        int largest = 0, pair = 0, diff = 0;
+        for (int i = 0; i < n; i++) {
+            largest = std::max(largest, segments[i]->tree.size());
+            if (i + 1 < n) {
+                int d = std::abs(segments[i]->tree.size() - segments[i + 1]->tree.size());
+                if (d > diff) {
+                    diff = d;
+                    pair = i;
+                }
+            }
+        }
+        if (largest <= limit || diff < 2)
+            break;
+        if (segments[pair]->tree.size() > segments[pair + 1]->tree.size())
+            _move(pair, pair + 1, diff / 2);
+        else
+            _move(pair + 1, pair, diff / 2);
+    }
+}
+
+// Перенести count крайних элементов сегмента from в соседний сегмент to и сдвинуть их общую границу.
+// Диапазон находится по порядковому номеру и переносится разрезом и слиянием поддеревьев за O(log n),
+// так что исключительная блокировка границ держится недолго. from после переноса не пуст,
+// так как переносится не более половины разности размеров.
+template<class Data, class Key>
+void ShardedTree<Data, Key>::_move(int from, int to, int count)
+{
+    Shard& source = segments[from]->tree;
+    Shard& target = segments[to]->tree;
+    if (to > from) {
+        Key lo = source.key_at(source.size() - count);
+        source.transfer(lo, source.max_key(), target);
+        bounds[from] = lo;
+    } else {
+        source.transfer(source.min_key(), source.key_at(count - 1), target);
+        bounds[to] = source.min_key();
+    }
+}
+
+//проверка сегментов и границ на корректность
+template<class Data, class Key>
+bool ShardedTree<Data, Key>::check()
+{
+    unique_lock<shared_timed_mutex> guard(bounds_lock);
+    int total = 0;
+    for (int i = 0; i < (int)segments.size(); i++) {
+        Shard& tree = segments[i]->tree;
+        if (!tree.check())
+            return false;
+        total += tree.size();
+        if (tree.empty())
+            continue;
+        typename Shard::Iterator it(tree);
+        it.begin();
+        if (i > 0 && it.key() < bounds[i - 1])
+            return false;
+        it.end();
+        if (i + 1 < (int)segments.size() && !(it.key() < bounds[i]))
+            return false;
+    }
+    return total == length;
+}
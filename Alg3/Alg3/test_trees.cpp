@@ -0,0 +1,461 @@
+// Сверочные тесты: деревья сравниваются с контейнерами std на случайных последовательностях операций.
+// Проверяются все способы балансировки, операции над диапазонами, перенос, кэш и сегментированное дерево.
+// Сборка: g++ -O1 -g -std=c++14 -pthread -fsanitize=address,undefined test_trees.cpp -o test_trees
+// (для сегментированного дерева полезна и сборка с -fsanitize=thread)
+// Запуск: test_trees [число раундов, по умолчанию 200]; код возврата 0 - все проверки прошли
+
+#include "avl.h"
+#include "rbt.h"
+#include "wavl.h"
+#include "treap.h"
+#include "cache.h"
+#include "sharded.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+
+static int failures = 0; //число непрошедших проверок
+
+//учесть проверку; при неудаче вывести ее описание
+static bool expect(bool ok, const char* suite, const char* what)
+{
+    if (!ok) {
+        failures++;
+        printf("FAIL %s: %s\n", suite, what);
+    }
+    return ok;
+}
+
+//ключи дерева в порядке LtR
+template<class T>
+static vector<int> keys_of(T& tree)
+{
+    vector<int> keys;
+    tree.for_each([&keys](int key, int&) { keys.push_back(key); return true; });
+    return keys;
+}
+
+//ключи эталона в порядке возрастания
+static vector<int> ref_keys(const map<int, int>& ref)
+{
+    vector<int> keys;
+    for (map<int, int>::const_iterator it = ref.begin(); it != ref.end(); ++it)
+        keys.push_back(it->first);
+    return keys;
+}
+
+// Случайные add/remove/pop_min/pop_max/find с проверкой структуры после каждой операции,
+// затем обходы, порядковая статистика и копия дерева.
+template<class T>
+static void test_engine(const char* name, int rounds)
+{
+    int before = failures;
+    mt19937 gen(42);
+    for (int round = 0; round < rounds; round++) {
+        T tree;
+        map<int, int> ref;
+        int n = gen() % 600;
+        for (int i = 0; i < 3 * n; i++) {
+            int key = gen() % 1000;
+            int action = gen() % 8;
+            bool ok = true;
+            if (action < 4)
+                ok = tree.add(key, i) == ref.insert(make_pair(key, i)).second;
+            else if (action < 6)
+                ok = tree.remove(key) == (ref.erase(key) == 1);
+            else if (action == 6 && !ref.empty()) {
+                int k, d;
+                ok = tree.pop_min(&k, &d) && k == ref.begin()->first && d == ref.begin()->second;
+                ref.erase(ref.begin());
+            }
+            else if (action == 7 && !ref.empty()) {
+                int k, d;
+                ok = tree.pop_max(&k, &d) && k == ref.rbegin()->first && d == ref.rbegin()->second;
+                ref.erase(--ref.end());
+            }
+            if (!expect(ok, name, "add/remove/pop disagree with std::map") || !expect(tree.check(), name, "check() after an update"))
+                return;
+        }
+        if (!expect(tree.size() == (int)ref.size(), name, "size"))
+            return;
+
+        vector<int> expected = ref_keys(ref);
+        expect(keys_of(tree) == expected, name, "for_each order");
+        vector<int> reverse;
+        tree.for_each_reverse([&reverse](int key, int&) { reverse.push_back(key); return true; });
+        expect(vector<int>(reverse.rbegin(), reverse.rend()) == expected, name, "for_each_reverse order");
+
+        int lo = gen() % 1000, hi = lo + gen() % 300;
+        vector<int> range, range_expected;
+        tree.for_each_in_range(lo, hi, [&range](int key, int&) { range.push_back(key); return true; });
+        for (map<int, int>::iterator it = ref.lower_bound(lo); it != ref.end() && it->first <= hi; ++it)
+            range_expected.push_back(it->first);
+        expect(range == range_expected, name, "for_each_in_range");
+
+        vector<int> iterated;
+        typename T::Iterator it(tree);
+        for (it.begin(); !it.is_off(); it.next())
+            iterated.push_back(it.key());
+        expect(iterated == expected, name, "Iterator order");
+
+        for (int q = 0; q < 100; q++) {
+            int key = gen() % 1100;
+            int* data = tree.find(key);
+            map<int, int>::iterator found = ref.find(key);
+            expect((data == NULL) == (found == ref.end()) && (data == NULL || *data == found->second), name, "find");
+        }
+        if (!ref.empty()) {
+            expect(tree.min_key() == ref.begin()->first && tree.max_key() == ref.rbegin()->first, name, "min_key/max_key");
+            int index = gen() % ref.size();
+            expect(tree.key_at(index) == expected[index], name, "key_at");
+        }
+
+        T copy(tree);
+        expect(copy.check() && keys_of(copy) == expected, name, "copy keys");
+        expect(copy.height() == tree.height() && copy.external_path_length() == tree.external_path_length(),
+               name, "copy structure");
+        copy.add(2000, 0);
+        expect(!tree.contains(2000), name, "copy is independent");
+    }
+    printf("%-8s %s\n", name, (failures == before) ? "ok" : "FAILED");
+}
+
+// Дерево с доступом к фильтру: после удаления всех ключей фильтр должен их отвергать.
+class FilteredTree: public AVLTree<int, int> {
+public:
+    bool may_contain(int key) {
+        return filter == NULL || filter->may_contain(key);
+    }
+};
+
+// remove_range, remove_if и transfer AVL-дерева с фильтром Блума и без него.
+static void test_ranges(int rounds)
+{
+    const char* name = "ranges";
+    int before = failures;
+    mt19937 gen(7);
+    for (int round = 0; round < rounds; round++) {
+        AVLTree<int, int> tree;
+        map<int, int> ref;
+        if (round % 2)
+            tree.enable_filter(4);
+        int n = gen() % 500;
+        for (int i = 0; i < n; i++) {
+            int key = gen() % 1000;
+            tree.add(key, key);
+            ref.insert(make_pair(key, key));
+        }
+
+        int lo = gen() % 1000, hi = lo + (int)(gen() % 400) - 50;
+        if (gen() % 2) {
+            int expected = 0;
+            for (map<int, int>::iterator it = ref.lower_bound(lo); lo <= hi && it != ref.end() && it->first <= hi; expected++)
+                it = ref.erase(it);
+            expect(tree.remove_range(lo, hi) == expected, name, "remove_range count");
+        }
+        else {
+            int expected = 0;
+            for (map<int, int>::iterator it = ref.lower_bound(lo); lo <= hi && it != ref.end() && it->first <= hi;)
+                if (it->first % 3 == 0) {
+                    it = ref.erase(it);
+                    expected++;
+                }
+                else
+                    ++it;
+            expect(tree.remove_if(lo, hi, [](int key, int&) { return key % 3 == 0; }) == expected, name, "remove_if count");
+        }
+        if (!expect(tree.check() && keys_of(tree) == ref_keys(ref), name, "keys after range removal"))
+            return;
+
+        try {
+            tree.remove_if(0, 1000, [](int key, int&) {
+                if (key > 500)
+                    throw runtime_error("pred");
+                return true;
+            });
+        }
+        catch (runtime_error&) {
+        }
+        if (!expect(tree.check() && keys_of(tree) == ref_keys(ref), name, "throwing remove_if predicate changed the tree"))
+            return;
+
+        AVLTree<int, int> target;
+        if (round % 4 < 2)
+            target.enable_filter(2);
+        bool above = gen() % 2;
+        int base = (above) ? 2000 : -1000;
+        int extra = gen() % 50;
+        for (int k = 0; k < extra; k++)
+            target.add(base + k, k);
+        int a = gen() % 1000, b = a + gen() % 300;
+        int expected = 0;
+        for (map<int, int>::iterator it = ref.lower_bound(a); it != ref.end() && it->first <= b; expected++)
+            it = ref.erase(it);
+        expect(tree.transfer(a, b, target) == expected, name, "transfer count");
+        expect(tree.check() && target.check() && target.size() == extra + expected, name, "check after transfer");
+        for (int k = -1000; k < 2100; k++)
+            if (!expect(tree.contains(k) == (ref.count(k) == 1), name, "contains after transfer"))
+                return;
+
+        bool thrown = false;
+        try {
+            if (extra > 0)
+                tree.transfer(-2000, 3000, target);
+        }
+        catch (runtime_error&) {
+            thrown = true;
+        }
+        expect(thrown == (extra > 0), name, "overlapping transfer must throw");
+    }
+
+    //перенос с ростом фильтра приемника: после удаления всех ключей счетчики фильтра обнуляются
+    for (int round = 0; round < rounds; round++) {
+        AVLTree<int, int> source;
+        FilteredTree target;
+        target.enable_filter(1 + round % 8);
+        int n = 1 + gen() % 300;
+        for (int k = 0; k < n; k++)
+            source.add(k, k);
+        for (int k = 0; k < round % 5; k++)
+            target.add(k - 1000, k);
+        int lo = 0, hi = -1;
+        while (hi < n - 1) {
+            lo = hi + 1;
+            hi = std::min(n - 1, lo + (int)(gen() % 40));
+            source.transfer(lo, hi, target);
+        }
+        target.remove_range(-1000, 1000);
+        bool clean = target.check() && target.size() == 0;
+        for (int k = 0; k < n && clean; k++)
+            clean = !target.may_contain(k);
+        if (!expect(clean, name, "filter counters left behind by transfer"))
+            break;
+    }
+    printf("%-8s %s\n", name, (failures == before) ? "ok" : "FAILED");
+}
+
+// Эталонная модель кэша с емкостью в записях. Порядок вытеснения - (число обращений, момент
+// последнего изменения этого числа) для LFU и момент последнего обращения для LRU.
+struct CacheModel {
+    bool lfu;
+    int bound;
+    int clock;
+    map<int, pair<int, int> > entries;  //ключ -> (число обращений, момент)
+    set<pair<pair<int, int>, int> > order; //(порядок вытеснения, ключ)
+
+    CacheModel(int bound, bool lfu) : lfu(lfu), bound(bound), clock(0) {
+    }
+
+    //порядок вытеснения записи
+    pair<int, int> rank(const pair<int, int>& entry) {
+        return (lfu) ? entry : make_pair(0, entry.second);
+    }
+
+    bool find(int key) {
+        map<int, pair<int, int> >::iterator it = entries.find(key);
+        if (it == entries.end())
+            return false;
+        order.erase(make_pair(rank(it->second), key));
+        it->second = make_pair(it->second.first + 1, clock++);
+        order.insert(make_pair(rank(it->second), key));
+        return true;
+    }
+
+    bool add(int key) {
+        if (entries.count(key) || bound < 1)
+            return false;
+        while ((int)entries.size() >= bound) {
+            entries.erase(order.begin()->second);
+            order.erase(order.begin());
+        }
+        entries[key] = make_pair(1, clock++);
+        order.insert(make_pair(rank(entries[key]), key));
+        return true;
+    }
+
+    bool remove(int key) {
+        map<int, pair<int, int> >::iterator it = entries.find(key);
+        if (it == entries.end())
+            return false;
+        order.erase(make_pair(rank(it->second), key));
+        entries.erase(it);
+        return true;
+    }
+};
+
+// CacheTree против эталонной модели: совпадают результаты операций и набор ключей.
+static void test_cache(CacheTree<int, int>::Policy policy, int rounds)
+{
+    bool lfu = (policy == CacheTree<int, int>::LFU);
+    const char* name = (lfu) ? "LFU" : "LRU";
+    int before = failures;
+    mt19937 gen(11);
+    for (int round = 0; round < rounds; round++) {
+        int capacity = 1 + gen() % 40;
+        CacheTree<int, int> cache(capacity, policy);
+        CacheModel model(capacity, lfu);
+        for (int i = 0; i < 2000; i++) {
+            int key = gen() % 100;
+            int action = gen() % 10;
+            bool ok = true;
+            if (action < 5)
+                ok = (cache.find(key) != NULL) == model.find(key);
+            else if (action < 9)
+                ok = cache.add(key, i) == model.add(key);
+            else
+                ok = cache.remove(key) == model.remove(key);
+            if (!expect(ok, name, "operation disagrees with the model")
+                || !expect(cache.check(), name, "check() after an update"))
+                return;
+        }
+        vector<int> expected;
+        for (map<int, pair<int, int> >::iterator it = model.entries.begin(); it != model.entries.end(); ++it)
+            expected.push_back(it->first);
+        expect(keys_of(cache) == expected, name, "cached keys");
+        expect(cache.hit_count() + cache.miss_count() > 0 && cache.used() == (long long)expected.size(), name, "counters");
+    }
+
+    //прогретый кэш: каждая запись прочитана, новая запись вытесняет старую, а не себя
+    CacheTree<int, int> warm(100, policy);
+    for (int key = 0; key < 100; key++)
+        warm.add(key, key);
+    for (int key = 0; key < 100; key++)
+        warm.find(key);
+    for (int key = 100; key < 1100; key++)
+        if (!expect(warm.add(key, key) && warm.contains(key), name, "freshly added key evicted by its own add"))
+            break;
+    expect(warm.check() && warm.size() == 100 && warm.eviction_count() == 1000, name, "evictions of a warm cache");
+
+    //удаления через ссылку на AVLTree убирают записи из списка вытеснения
+    CacheTree<int, int> shared(50, policy);
+    AVLTree<int, int>& base = shared;
+    for (int key = 0; key < 40; key++)
+        shared.add(key, key);
+    for (int key = 0; key < 40; key += 3)
+        shared.find(key);
+    expect(base.remove_range(10, 19) == 10 && shared.check() && shared.used() == 30, name, "remove_range through AVLTree&");
+    expect(base.remove_if(0, 39, [](int key, int&) { return key % 2 == 0; }) == 15 && shared.check(), name, "remove_if through AVLTree&");
+    for (int key = 100; key < 160; key++)
+        shared.add(key, key);
+    expect(shared.check() && shared.size() == 50, name, "eviction after removals through AVLTree&");
+    AVLTree<int, int> plain;
+    plain.add(1000, 0);
+    int thrown = 0;
+    try {
+        base.transfer(100, 200, plain);
+    }
+    catch (runtime_error&) {
+        thrown++;
+    }
+    try {
+        plain.transfer(1000, 1000, base);
+    }
+    catch (runtime_error&) {
+        thrown++;
+    }
+    expect(thrown == 2 && plain.size() == 1 && shared.check() && shared.size() == 50, name, "transfer of cache nodes must throw");
+    base.clear();
+    expect(shared.check() && shared.used() == 0 && shared.add(1, 1) && shared.check(), name, "clear through AVLTree&");
+    Tree<int, int>* owned = new CacheTree<int, int>(10, policy);
+    for (int key = 0; key < 20; key++)
+        owned->add(key, key);
+    delete owned;
+
+    //запись больше емкости не добавляется и ничего не вытесняет
+    CacheTree<int, int> bytes(100, policy, CacheTree<int, int>::BYTES, [](const int& key, const int&) { return key; });
+    bytes.add(30, 0);
+    bytes.add(60, 0);
+    expect(!bytes.add(101, 0) && bytes.size() == 2 && bytes.eviction_count() == 0, name, "oversized entry");
+    expect(bytes.add(40, 0) && !bytes.contains(30) && bytes.contains(60) && bytes.used() == 100 && bytes.check(), name, "byte capacity eviction");
+    printf("%-8s %s\n", name, (failures == before) ? "ok" : "FAILED");
+}
+
+// Сегментированное дерево: потоки вставляют и удаляют непересекающиеся наборы ключей,
+// автоматический перенос границ идет параллельно, итератор обходит дерево во время записи.
+static void test_sharded(int rounds)
+{
+    const char* name = "sharded";
+    int before = failures;
+    const int threads = 4;
+    for (int round = 0; round < rounds / 20 + 1; round++) {
+        vector<int> bounds;
+        for (int i = 1; i < 8; i++)
+            bounds.push_back(i * 100);
+        ShardedTree<int, int> tree(bounds, 1.5);
+        vector<thread> workers;
+        for (int t = 0; t < threads; t++)
+            workers.push_back(thread([&tree, t, round]() {
+                mt19937 gen(round * threads + t);
+                for (int i = 0; i < 3000; i++) {
+                    int key = (int)(gen() % 2000) * threads + t;
+                    if (gen() % 3)
+                        tree.add(key, key);
+                    else
+                        tree.remove(key);
+                }
+            }));
+        bool ordered = true;
+        workers.push_back(thread([&tree, &ordered]() {
+            for (int pass = 0; pass < 5; pass++) {
+                ShardedTree<int, int>::Iterator it(tree);
+                int prev = -1;
+                for (it.begin(); !it.is_off(); it.next()) {
+                    if (it.key() <= prev)
+                        ordered = false;
+                    prev = it.key();
+                }
+                this_thread::yield();
+            }
+        }));
+        for (size_t t = 0; t < workers.size(); t++)
+            workers[t].join();
+        expect(ordered, name, "iterator order under concurrent writers");
+
+        //повторить ту же последовательность операций потоков на эталоне
+        set<int> ref;
+        for (int t = 0; t < threads; t++) {
+            mt19937 gen(round * threads + t);
+            for (int i = 0; i < 3000; i++) {
+                int key = (int)(gen() % 2000) * threads + t;
+                if (gen() % 3)
+                    ref.insert(key);
+                else
+                    ref.erase(key);
+            }
+        }
+        expect(tree.check() && tree.size() == (int)ref.size(), name, "check and size");
+        vector<int> keys;
+        tree.scan(0, 1 << 30, [&keys](int key, int&) { keys.push_back(key); });
+        expect(keys == vector<int>(ref.begin(), ref.end()), name, "scanned keys");
+        tree.rebalance();
+        expect(tree.check() && tree.size() == (int)ref.size(), name, "check after rebalance");
+    }
+    printf("%-8s %s\n", name, (failures == before) ? "ok" : "FAILED");
+}
+
+int main(int argc, char* argv[])
+{
+    int rounds = (argc > 1) ? atoi(argv[1]) : 200;
+
+    test_engine<AVLTree<int, int> >("AVL", rounds);
+    test_engine<RBTree<int, int> >("RB", rounds);
+    test_engine<WAVLTree<int, int> >("WAVL", rounds);
+    test_engine<Treap<int, int> >("Treap", rounds);
+    test_ranges(rounds);
+    test_cache(CacheTree<int, int>::LRU, rounds);
+    test_cache(CacheTree<int, int>::LFU, rounds);
+    test_sharded(rounds);
+
+    if (failures)
+        printf("%d checks failed\n", failures);
+    return (failures) ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "bst.h"
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <exception>
+
+
+using namespace std;
+
+// Декартово дерево (treap). Случайный приоритет узла хранится в поле height,
+// по приоритетам дерево является кучей с максимумом в корне.
+template <class Data, class Key> class Treap: public Tree<Data, Key> {
+
+public:
+    typedef TNode<Data, Key> Node;
+
+    Treap(unsigned int seed = 2463534242u);                 //конструктор с начальным значением генератора
+    ~Treap(void);                                           //деструктор
+
+    virtual bool add(Key key, Data obj, int* op = NULL);    //включение данных с заданным ключом
+    virtual bool remove(Key key, int* op = NULL);           //удаление данных с заданным ключом
+    bool check();                                           //проверка структуры узлов на корректность
+
+protected:
+    virtual void _erase(Node* z, int* op = NULL);           //удаление узла z с балансировкой и освобождением
+
+private:
+    unsigned int state;                                     //состояние генератора приоритетов
+
+    virtual void _show(Node* r, int level, ostream& out);   //вспомогательная функция для вывода структуры
+
+    bool _check(Node* node);                                //проверка на внутреннюю целостность дерева
+    int _random();                                          //следующий приоритет (xorshift32)
+};
+
+//конструктор с начальным значением генератора
+template<class Data, class Key>
+Treap<Data, Key>::Treap(unsigned int seed)
+{
+    state = (seed) ? seed : 1;
+}
+
+//деструктор
+template<class Data, class Key>
+Treap<Data, Key>::~Treap(void)
+{
+}
+
+//следующий приоритет
+template<class Data, class Key>
+int Treap<Data, Key>::_random()
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (int)(state >> 1);
+}
+
+//проверка корректности дерева
+template<class Data, class Key>
+bool Treap<Data, Key>::check()
+{
+    if (!this->root)
+        return this->_check_ends();
+    if (this->root->parent)
+        return false;
+    return _check(this->root) && this->_check_stats(this->root) && this->_check_ends();
+}
+
+// проверка на корректность структуры дерева: ссылки на родителей и детей взаимно согласованы,
+// приоритет сына не больше приоритета родителя.
+template<class Data, class Key>
+bool Treap<Data, Key>::_check(Node* node)
+{
+    if (!node)
+        return true;
+    if (node->left && (node->left->parent != node || !(node->left->key < node->key) || node->left->height > node->height))
+        return false;
+    if (node->right && (node->right->parent != node || !(node->key < node->right->key) || node->right->height > node->height))
+        return false;
+    return _check(node->left) && _check(node->right);
+}
+
+//вспомогательная функция для вывода структуры
+template <class Data, class Key>
+void Treap<Data, Key>::_show(Node* r, int level, ostream& out)
+{
+    if (r == NULL)
+        return;
+    _show(r->right, level + 1, out);
+    for (int i = 0; i <= 2 * level; i++)
+        out << " ";
+    out << r->key << "," << r->height << '\n';
+    _show(r->left, level + 1, out);
+}
+
+// добавление элемента: новый лист получает случайный приоритет и поднимается поворотами,
+// пока приоритет родителя меньше
+template<class Data, class Key>
+bool Treap<Data, Key>::add(Key key, Data data, int* op)
+{
+    if (op)
+        *op = 0;
+    Node* x = this->_just_add(key, data, op);
+    if (!x) // не добавлен
+        return false;
+
+    x->height = _random();
+    while (x->parent && x->parent->height < x->height) {
+        if (op)
+            ++*op;
+        if (x == x->parent->left)
+            this->_rotate_right(x->parent);
+        else
+            this->_rotate_left(x->parent);
+    }
+    this->_pull_up(x);
+    return true;
+}
+
+//удаление данных с заданным ключом
+template<class Data, class Key>
+bool Treap<Data, Key>::remove(Key key, int* op)
+{
+    if (op)
+        *op = 0;
+
+    Node* z = this->_find(key, op);
+    if (!z) // не удален
+        return false;
+
+    _erase(z, op);
+    return true;
+}
+
+// удаление узла: узел опускается поворотами в сторону сына с большим приоритетом,
+// пока у него не останется не более одного сына, после чего исключается
+template<class Data, class Key>
+void Treap<Data, Key>::_erase(Node* z, int* op)
+{
+    while (z->left && z->right) {
+        if (op)
+            ++*op;
+        if (z->left->height > z->right->height)
+            this->_rotate_right(z);
+        else
+            this->_rotate_left(z);
+    }
+
+    Node* x;
+    Node* xparent;
+    this->_destroy(this->_unlink(z, x, xparent));
+    this->_pull_up(xparent);
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "bst.h"
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <exception>
+
+
+using namespace std;
+
+// Слабое AVL-дерево (WAVL). Ранг узла хранится в поле height: ранг пустого сына 0, листа 1,
+// разность рангов родителя и сына всегда 1 или 2. Без удалений дерево совпадает с AVL,
+// а удаление выполняет не более двух поворотов.
+template <class Data, class Key> class WAVLTree: public Tree<Data, Key> {
+
+public:
+    typedef TNode<Data, Key> Node;
+
+    WAVLTree();                                             //конструктор без параметров
+    ~WAVLTree(void);                                        //деструктор
+
+    virtual bool add(Key key, Data obj, int* op = NULL);    //включение данных с заданным ключом
+    virtual bool remove(Key key, int* op = NULL);           //удаление данных с заданным ключом
+    bool check();                                           //проверка структуры узлов на корректность
+
+protected:
+    virtual void _erase(Node* z, int* op = NULL);           //удаление узла z с балансировкой и освобождением
+
+private:
+    virtual void _show(Node* r, int level, ostream& out);   //вспомогательная функция для вывода структуры
+
+    bool _check(Node* node);                                //проверка на внутреннюю целостность дерева
+    int _rank(Node* node);                                  //ранг узла (пустой узел - 0)
+};
+
+//конструктор без параметров
+template<class Data, class Key>
+WAVLTree<Data, Key>::WAVLTree(void)
+{
+}
+
+//деструктор
+template<class Data, class Key>
+WAVLTree<Data, Key>::~WAVLTree(void)
+{
+}
+
+//ранг узла
+template<class Data, class Key>
+int WAVLTree<Data, Key>::_rank(Node* node)
+{
+    return (node) ? node->height : 0;
+}
+
+//проверка корректности дерева
+template<class Data, class Key>
+bool WAVLTree<Data, Key>::check()
+{
+    if (!this->root)
+        return this->_check_ends();
+    if (this->root->parent)
+        return false;
+    return _check(this->root) && this->_check_stats(this->root) && this->_check_ends();
+}
+
+// проверка на корректность структуры дерева: ссылки на родителей и детей взаимно согласованы,
+// разности рангов равны 1 или 2, а листья имеют ранг 1.
+template<class Data, class Key>
+bool WAVLTree<Data, Key>::_check(Node* node)
+{
+    if (!node)
+        return true;
+    if (node->left && (node->left->parent != node || !(node->left->key < node->key)))
+        return false;
+    if (node->right && (node->right->parent != node || !(node->key < node->right->key)))
+        return false;
+    int ldiff = node->height - _rank(node->left);
+    int rdiff = node->height - _rank(node->right);
+    if (ldiff < 1 || ldiff > 2 || rdiff < 1 || rdiff > 2)
+        return false;
+    if (!node->left && !node->right && node->height != 1)
+        return false;
+    return _check(node->left) && _check(node->right);
+}
+
+//вспомогательная функция для вывода структуры
+template <class Data, class Key>
+void WAVLTree<Data, Key>::_show(Node* r, int level, ostream& out)
+{
+    if (r == NULL)
+        return;
+    _show(r->right, level + 1, out);
+    for (int i = 0; i <= 2 * level; i++)
+        out << " ";
+    out << r->key << "," << r->height << '\n';
+    _show(r->left, level + 1, out);
+}
+
+// Добавление: пока x - 0-сын своего родителя p, либо повышаем p (если брат x - 1-сын),
+// либо одним или двумя поворотами завершаем балансировку.
+template<class Data, class Key>
+bool WAVLTree<Data, Key>::add(Key key, Data data, int* op)
+{
+    if (op)
+        *op = 0;
+    Node* x = this->_just_add(key, data, op);
+    if (!x) // не добавлен
+        return false;
+
+    Node* new_node = x;
+    Node* p = x->parent;
+    while (p && p->height == x->height) {
+        if (op)
+            ++*op;
+
+        Node* s = (p->left == x) ? p->right : p->left;
+        if (p->height - _rank(s) == 1) {
+            p->height++;
+            x = p;
+            p = p->parent;
+            continue;
+        }
+
+        // p - (0,2)-узел
+        if (x == p->left) {
+            Node* y = x->right;
+            if (x->height - _rank(y) == 2) {
+                this->_rotate_right(p);
+                p->height--;
+            } else {
+                this->_rotate_left(x);
+                this->_rotate_right(p);
+                y->height++;
+                x->height--;
+                p->height--;
+            }
+        } else {
+            Node* y = x->left;
+            if (x->height - _rank(y) == 2) {
+                this->_rotate_left(p);
+                p->height--;
+            } else {
+                this->_rotate_right(x);
+                this->_rotate_left(p);
+                y->height++;
+                x->height--;
+                p->height--;
+            }
+        }
+        break;
+    }
+
+    this->_pull_up(new_node);
+    return true;
+}
+
+//удаление данных с заданным ключом
+template<class Data, class Key>
+bool WAVLTree<Data, Key>::remove(Key key, int* op)
+{
+    if (op)
+        *op = 0;
+
+    Node* z = this->_find(key, op);
+    if (!z) // не удален
+        return false;
+
+    _erase(z, op);
+    return true;
+}
+
+// Удаление узла: лист ранга 2 понижается, затем пока x - 3-сын своего родителя p, понижаем p
+// (и брата, если он (2,2)-узел), либо одним или двумя поворотами завершаем балансировку.
+template<class Data, class Key>
+void WAVLTree<Data, Key>::_erase(Node* z, int* op)
+{
+    Node* x;
+    Node* p;
+    this->_destroy(this->_unlink(z, x, p));
+    Node* parent = p;
+
+    if (p && !p->left && !p->right && p->height == 2) {
+        p->height = 1;
+        x = p;
+        p = p->parent;
+    }
+
+    while (p && p->height - _rank(x) == 3) {
+        if (op)
+            ++*op;
+
+        bool left = (p->left == x);
+        Node* y = left ? p->right : p->left;
+        if (p->height - y->height == 2) {
+            p->height--;
+            x = p;
+            p = p->parent;
+            continue;
+        }
+        if (y->height - _rank(y->left) == 2 && y->height - _rank(y->right) == 2) {
+            p->height--;
+            y->height--;
+            x = p;
+            p = p->parent;
+            continue;
+        }
+
+        Node* outer = left ? y->right : y->left;
+        Node* inner = left ? y->left : y->right;
+        if (y->height - _rank(outer) == 1) {
+            if (left)
+                this->_rotate_left(p);
+            else
+                this->_rotate_right(p);
+            y->height++;
+            p->height--;
+            if (!p->left && !p->right)
+                p->height--;
+        } else {
+            if (left) {
+                this->_rotate_right(y);
+                this->_rotate_left(p);
+            } else {
+                this->_rotate_left(y);
+                this->_rotate_right(p);
+            }
+            inner->height += 2;
+            y->height--;
+            p->height -= 2;
+        }
+        break;
+    }
+
+    this->_pull_up(parent);
+}